@@ -0,0 +1,453 @@
+#include <benchmark/benchmark.h>
+
+#include "../src/Tape/Tape.h"
+#include "../src/Tape/BinaryTape.h"
+#include "../src/Tape/CompressedTape.h"
+#include "../src/Tape/BlockWriter.h"
+#include "../src/Tape/Clock.h"
+#include "../src/Tape/TextCodec.h"
+#include "../src/Sort/Sort.h"
+#include "../src/Sort/LoserTree.h"
+#include "../src/Sort/RadixSort.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Benchmarks of tape primitives and sort
+// Run from build/bench folder, so paths of sort settings and temp folder are the same as for tests
+// Results are saved for comparing between commits with:
+//   ./benchmarks --benchmark_out=bench.json --benchmark_out_format=json
+//   compare.py benchmarks old.json new.json (tool from Google Benchmark)
+// Tapes use virtual clock, so delays don't slow benchmarks down, modelled time is reported by device_ms counter
+
+#define BENCH_FOLDER "../../src/tmp/bench"
+#define BENCH_SETTINGS SETTINGS_PATH
+
+// Delay of every tape operation in milliseconds for tapes of primitive benchmarks and input tapes of sort
+TapeSettings CreateSettings(int64_t delay) {
+    TapeSettings settings((int32_t) delay, (int32_t) delay, (int32_t) delay, (int32_t) delay);
+    settings.SetClockMode(ClockMode::Virtual);
+
+    return settings;
+}
+
+std::string BenchFile(const std::string& name) {
+    std::filesystem::create_directories(BENCH_FOLDER);
+
+    return std::string(BENCH_FOLDER) + "/" + name;
+}
+
+std::vector<int32_t> CreateRandomValues(int64_t n, uint32_t seed) {
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int32_t> distribution(INT32_MIN, INT32_MAX);
+
+    std::vector<int32_t> values(n);
+    for (auto& value: values) {
+        value = distribution(generator);
+    }
+
+    return values;
+}
+
+// Text file with n random numbers, it's input of sort and tape benchmarks
+void CreateTextFile(const std::string& file, int64_t n) {
+    auto values = CreateRandomValues(n, (uint32_t) n);
+
+    std::ofstream stream(file, std::ofstream::out | std::ofstream::trunc);
+    for (int64_t i = 0; i < n; i++) {
+        stream << (i > 0 ? " " : "") << values[i];
+    }
+}
+
+// Counters that are reported by every tape benchmark
+void ReportTape(benchmark::State& state, int64_t cells, std::chrono::microseconds device_time) {
+    state.SetItemsProcessed(state.iterations() * cells);
+    state.counters["device_ms"] = benchmark::Counter((double) device_time.count() / 1000,
+                                                     benchmark::Counter::kAvgIterations);
+}
+
+// Args: N, delay
+void BM_TapeWrite(benchmark::State& state) {
+    auto settings = CreateSettings(state.range(1));
+    std::chrono::microseconds device_time(0);
+
+    for (auto _: state) {
+        std::filesystem::remove(BenchFile("write.txt"));
+        auto tape = new Tape(BenchFile("write.txt"), settings);
+        for (int64_t i = 0; i < state.range(0); i++) {
+            tape->Write((int32_t) i);
+            tape->ShiftLeft();
+        }
+        device_time += tape->GetDeviceTime();
+        delete tape;
+    }
+
+    ReportTape(state, state.range(0), device_time);
+}
+
+void BM_TapeRead(benchmark::State& state) {
+    CreateTextFile(BenchFile("read.txt"), state.range(0));
+    auto settings = CreateSettings(state.range(1));
+    std::chrono::microseconds device_time(0);
+
+    auto tape = new Tape(BenchFile("read.txt"), settings);
+    for (auto _: state) {
+        auto before = tape->GetDeviceTime();
+        tape->Rewind();
+        while (tape->GetPosition() < tape->GetN()) {
+            benchmark::DoNotOptimize(tape->Read());
+            tape->ShiftLeft();
+        }
+        device_time += tape->GetDeviceTime() - before;
+    }
+    delete tape;
+
+    ReportTape(state, state.range(0), device_time);
+}
+
+// Head go to the end of tape and back
+void BM_TapeShift(benchmark::State& state) {
+    CreateTextFile(BenchFile("shift.txt"), state.range(0));
+    auto settings = CreateSettings(state.range(1));
+    std::chrono::microseconds device_time(0);
+
+    auto tape = new Tape(BenchFile("shift.txt"), settings);
+    for (auto _: state) {
+        auto before = tape->GetDeviceTime();
+        while (tape->GetPosition() < tape->GetN()) {
+            tape->ShiftLeft();
+        }
+        while (tape->GetPosition() > 0) {
+            tape->ShiftRight();
+        }
+        device_time += tape->GetDeviceTime() - before;
+    }
+    delete tape;
+
+    ReportTape(state, 2 * state.range(0), device_time);
+}
+
+// Text tape read from the end to the start, every block is found by sparse index of the tape, Args: N
+void BM_TapeReadBackward(benchmark::State& state) {
+    CreateTextFile(BenchFile("backward.txt"), state.range(0));
+    TapeSettings settings;
+
+    auto tape = new Tape(BenchFile("backward.txt"), settings);
+    for (auto _: state) {
+        while (tape->GetPosition() < tape->GetN()) {
+            tape->ShiftLeft();
+        }
+        while (tape->GetPosition() > 0) {
+            tape->ShiftRight();
+            benchmark::DoNotOptimize(tape->Read());
+        }
+    }
+    delete tape;
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Bulk read of binary tape, Args: N, delay
+void BM_BinaryTapeReadBlock(benchmark::State& state) {
+    auto settings = CreateSettings(state.range(1));
+    auto values = CreateRandomValues(state.range(0), 1);
+    std::chrono::microseconds device_time(0);
+
+    std::filesystem::remove(BenchFile("block.bin"));
+    auto tape = new BinaryTape(BenchFile("block.bin"), settings);
+    tape->WriteBlock(values.data(), (int64_t) values.size());
+    for (auto _: state) {
+        auto before = tape->GetDeviceTime();
+        tape->Rewind();
+        tape->ReadBlock(values.data(), (int64_t) values.size());
+        device_time += tape->GetDeviceTime() - before;
+    }
+    delete tape;
+
+    ReportTape(state, state.range(0), device_time);
+}
+
+// Bulk write and read of sorted run on compressed tape, bytes_per_number show ratio of compression, Args: N
+void BM_CompressedTapeRun(benchmark::State& state) {
+    TapeSettings settings;
+    auto values = CreateRandomValues(state.range(0), 2);
+    std::sort(values.begin(), values.end());
+    int64_t file_size = 0;
+
+    for (auto _: state) {
+        std::filesystem::remove(BenchFile("run.cmp"));
+        auto tape = new CompressedTape(BenchFile("run.cmp"), settings);
+        tape->WriteBlock(values.data(), (int64_t) values.size());
+        tape->Rewind();
+        tape->ReadBlock(values.data(), (int64_t) values.size());
+        file_size = tape->GetFileSize();
+        delete tape;
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["bytes_per_number"] = (double) file_size / (double) state.range(0);
+}
+
+// Text tape count numbers of file when it's opened, Args: N
+void BM_CalculateN(benchmark::State& state) {
+    CreateTextFile(BenchFile("count.txt"), state.range(0));
+    TapeSettings settings;
+
+    for (auto _: state) {
+        auto tape = new Tape(BenchFile("count.txt"), settings);
+        benchmark::DoNotOptimize(tape->GetN());
+        delete tape;
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Conversion of text input to binary tape and back as --binary option of app do it, Args: N
+void BM_ImportExport(benchmark::State& state) {
+    CreateTextFile(BenchFile("import.txt"), state.range(0));
+
+    for (auto _: state) {
+        ImportTextFile(BenchFile("import.txt"), BenchFile("import.bin"));
+        ExportTextFile(BenchFile("import.bin"), BenchFile("export.txt"));
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Sort of one chunk in run generation, Args: chunk size
+void BM_RunStdSort(benchmark::State& state) {
+    auto input = CreateRandomValues(state.range(0), 42);
+    std::vector<int32_t> values;
+
+    for (auto _: state) {
+        state.PauseTiming();
+        values = input;
+        state.ResumeTiming();
+
+        std::sort(values.begin(), values.end());
+        benchmark::DoNotOptimize(values.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_RunRadixSort(benchmark::State& state) {
+    auto input = CreateRandomValues(state.range(0), 42);
+    std::vector<int32_t> values;
+    std::vector<int32_t> scratch(input.size());
+
+    for (auto _: state) {
+        state.PauseTiming();
+        values = input;
+        state.ResumeTiming();
+
+        RadixSort(values.data(), scratch.data(), values.size());
+        benchmark::DoNotOptimize(values.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Merge of K sorted binary tapes by loser tree as merge of sort do it, Args: K, numbers on every tape, buffer size
+void BM_MergeFiles(benchmark::State& state) {
+    auto settings = CreateSettings(1);
+    int64_t k = state.range(0);
+    int64_t n = state.range(1);
+    std::chrono::microseconds device_time(0);
+
+    std::vector<ITape*> tapes;
+    for (int64_t i = 0; i < k; i++) {
+        auto values = CreateRandomValues(n, (uint32_t) i);
+        std::sort(values.begin(), values.end());
+
+        std::filesystem::remove(BenchFile(std::to_string(i) + ".bin"));
+        tapes.push_back(new BinaryTape(BenchFile(std::to_string(i) + ".bin"), settings));
+        tapes.back()->WriteBlock(values.data(), (int64_t) values.size());
+    }
+    std::filesystem::remove(BenchFile("merged.bin"));
+    auto merged_tape = new BinaryTape(BenchFile("merged.bin"), settings);
+
+    for (auto _: state) {
+        std::chrono::microseconds before = merged_tape->GetDeviceTime();
+        for (auto tape: tapes) {
+            before += tape->GetDeviceTime();
+            tape->Rewind();
+        }
+        merged_tape->Rewind();
+
+        BlockWriter merged(merged_tape, state.range(2));
+        LoserTree tree(tapes, nullptr, state.range(2));
+        while (!tree.Empty()) {
+            merged.Write(tree.Top());
+            tree.Pop();
+        }
+        merged.Flush();
+
+        std::chrono::microseconds after = merged_tape->GetDeviceTime();
+        for (auto tape: tapes) {
+            after += tape->GetDeviceTime();
+        }
+        device_time += after - before;
+    }
+
+    for (auto tape: tapes) {
+        delete tape;
+    }
+    delete merged_tape;
+
+    ReportTape(state, k * n, device_time);
+}
+
+// Whole sort, temp tapes use sort settings file, Args: N, M, merge mode, delay
+void BM_Sort(benchmark::State& state) {
+    CreateTextFile(BenchFile("input.txt"), state.range(0));
+    TapeSettings settings = CreateSettings(state.range(3));
+    SortSettings sort_settings(BENCH_SETTINGS);
+    sort_settings.SetMergeMode((MergeMode) state.range(2));
+    std::chrono::microseconds device_time(0);
+
+    for (auto _: state) {
+        Clock::Global().Reset();
+        auto tape = new Tape(BenchFile("input.txt"), settings);
+        auto sort = new Sort(tape, BenchFile("output.txt"), state.range(1), sort_settings);
+        sort->Start();
+        device_time += Clock::Global().GetElapsed();
+
+        delete sort;
+        delete tape;
+    }
+
+    ReportTape(state, state.range(0), device_time);
+}
+
+// Sort of input made of 16 time ordered batches, Args: N, run generation, delay
+void BM_SortBatches(benchmark::State& state) {
+    int64_t n = state.range(0);
+    {
+        std::ofstream stream(BenchFile("batches.txt"), std::ofstream::out | std::ofstream::trunc);
+        for (int64_t i = 0; i < n; i++) {
+            int64_t batch = i / (n / 16);
+            stream << (i > 0 ? " " : "") << (i % (n / 16)) * 16 + batch;
+        }
+    }
+    TapeSettings settings = CreateSettings(state.range(2));
+    SortSettings sort_settings(BENCH_SETTINGS);
+    sort_settings.SetRunGeneration((RunGeneration) state.range(1));
+    std::chrono::microseconds device_time(0);
+
+    for (auto _: state) {
+        Clock::Global().Reset();
+        auto tape = new Tape(BenchFile("batches.txt"), settings);
+        auto sort = new Sort(tape, BenchFile("output.txt"), 1 << 14, sort_settings);
+        sort->Start();
+        device_time += Clock::Global().GetElapsed();
+
+        delete sort;
+        delete tape;
+    }
+
+    ReportTape(state, n, device_time);
+}
+
+// Whole sort with merge or distribution strategy, Args: N, M, strategy, delay
+void BM_SortStrategy(benchmark::State& state) {
+    CreateTextFile(BenchFile("input.txt"), state.range(0));
+    TapeSettings settings = CreateSettings(state.range(3));
+    SortSettings sort_settings(BENCH_SETTINGS);
+    sort_settings.SetStrategy((SortStrategy) state.range(2));
+    std::chrono::microseconds device_time(0);
+
+    for (auto _: state) {
+        Clock::Global().Reset();
+        auto tape = new Tape(BenchFile("input.txt"), settings);
+        auto sort = new Sort(tape, BenchFile("output.txt"), state.range(1), sort_settings);
+        sort->Start();
+        device_time += Clock::Global().GetElapsed();
+
+        delete sort;
+        delete tape;
+    }
+
+    ReportTape(state, state.range(0), device_time);
+}
+
+// Sort of input with 1000 distinct status codes, Args: N, counting, delay
+void BM_SortCodes(benchmark::State& state) {
+    int64_t n = state.range(0);
+    {
+        std::mt19937 generator(5);
+        std::ofstream stream(BenchFile("codes.txt"), std::ofstream::out | std::ofstream::trunc);
+        for (int64_t i = 0; i < n; i++) {
+            stream << (i > 0 ? " " : "") << generator() % 1000;
+        }
+    }
+    TapeSettings settings = CreateSettings(state.range(2));
+    SortSettings sort_settings(BENCH_SETTINGS);
+    sort_settings.SetCounting(state.range(1) != 0);
+    std::chrono::microseconds device_time(0);
+
+    for (auto _: state) {
+        Clock::Global().Reset();
+        auto tape = new Tape(BenchFile("codes.txt"), settings);
+        auto sort = new Sort(tape, BenchFile("output.txt"), 1 << 16, sort_settings);
+        sort->Start();
+        device_time += Clock::Global().GetElapsed();
+
+        delete sort;
+        delete tape;
+    }
+
+    ReportTape(state, n, device_time);
+}
+
+// K least numbers of input, K = N is full sort, Args: N, K, delay
+void BM_SortPartial(benchmark::State& state) {
+    CreateTextFile(BenchFile("input.txt"), state.range(0));
+    TapeSettings settings = CreateSettings(state.range(2));
+    SortSettings sort_settings(BENCH_SETTINGS);
+    std::chrono::microseconds device_time(0);
+
+    for (auto _: state) {
+        Clock::Global().Reset();
+        auto tape = new Tape(BenchFile("input.txt"), settings);
+        auto sort = new Sort(tape, BenchFile("output.txt"), 1 << 16, sort_settings);
+        sort->StartPartial(state.range(1));
+        device_time += Clock::Global().GetElapsed();
+
+        delete sort;
+        delete tape;
+    }
+
+    ReportTape(state, state.range(0), device_time);
+}
+
+BENCHMARK(BM_TapeWrite)->ArgsProduct({{1 << 10, 1 << 14}, {0, 1}});
+BENCHMARK(BM_TapeRead)->ArgsProduct({{1 << 10, 1 << 14}, {0, 1}});
+BENCHMARK(BM_TapeShift)->ArgsProduct({{1 << 10, 1 << 14}, {0, 1}});
+BENCHMARK(BM_TapeReadBackward)->RangeMultiplier(16)->Range(1 << 14, 1 << 18);
+BENCHMARK(BM_BinaryTapeReadBlock)->ArgsProduct({{1 << 14, 1 << 18}, {0, 1}});
+BENCHMARK(BM_CompressedTapeRun)->RangeMultiplier(16)->Range(1 << 14, 1 << 18);
+BENCHMARK(BM_CalculateN)->RangeMultiplier(16)->Range(1 << 10, 1 << 18);
+BENCHMARK(BM_ImportExport)->RangeMultiplier(16)->Range(1 << 10, 1 << 18);
+BENCHMARK(BM_RunStdSort)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_RunRadixSort)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_MergeFiles)->ArgsProduct({{2, 8, 32}, {1 << 12}, {0, 256}});
+BENCHMARK(BM_Sort)
+        ->ArgsProduct({{1 << 12, 1 << 16}, {1 << 12, 1 << 16},
+                       {(int64_t) MergeMode::Balanced, (int64_t) MergeMode::Polyphase, (int64_t) MergeMode::Backward}, {0, 1}})
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SortStrategy)
+        ->ArgsProduct({{1 << 16}, {1 << 12, 1 << 14}, {(int64_t) SortStrategy::Merge, (int64_t) SortStrategy::Distribution}, {0, 1}})
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SortCodes)->ArgsProduct({{1 << 18}, {0, 1}, {0, 1}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SortPartial)->ArgsProduct({{1 << 18}, {100, 1 << 14, 1 << 18}, {0, 1}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SortBatches)
+        ->ArgsProduct({{1 << 16}, {(int64_t) RunGeneration::Chunk, (int64_t) RunGeneration::ReplacementSelection,
+                                   (int64_t) RunGeneration::Natural}, {0, 1}})
+        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,63 @@
+#ifndef TEST_BUDGETALLOCATOR_H
+#define TEST_BUDGETALLOCATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+#include "MemoryAccount.h"
+
+// BudgetAllocator is std allocator that report every allocation to MemoryAccount
+// Allocator without account work as std::allocator
+template <class T>
+class BudgetAllocator {
+public:
+    using value_type = T;
+    // Containers keep account of allocator that was assigned to them
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    BudgetAllocator() noexcept : account(nullptr) {}
+    explicit BudgetAllocator(MemoryAccount* account) noexcept : account(account) {}
+    template <class U>
+    BudgetAllocator(const BudgetAllocator<U>& other) noexcept : account(other.GetAccount()) {}
+
+    T* allocate(size_t n) {
+        if (this->account != nullptr) {
+            this->account->Allocate(n * sizeof(T));
+        }
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* pointer, size_t n) noexcept {
+        if (this->account != nullptr) {
+            this->account->Deallocate(n * sizeof(T));
+        }
+        std::allocator<T>().deallocate(pointer, n);
+    }
+
+    MemoryAccount* GetAccount() const noexcept {
+        return this->account;
+    }
+
+    template <class U>
+    bool operator==(const BudgetAllocator<U>& other) const noexcept {
+        return this->account == other.GetAccount();
+    }
+
+    template <class U>
+    bool operator!=(const BudgetAllocator<U>& other) const noexcept {
+        return this->account != other.GetAccount();
+    }
+private:
+    MemoryAccount* account;
+};
+
+// Vector that memory is counted by account
+template <class T>
+using BudgetVector = std::vector<T, BudgetAllocator<T>>;
+
+
+#endif //TEST_BUDGETALLOCATOR_H
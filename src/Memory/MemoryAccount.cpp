@@ -0,0 +1,35 @@
+#include "MemoryAccount.h"
+
+#include <cassert>
+
+MemoryAccount::MemoryAccount(int64_t limit) : current(0), peak(0) {
+    this->limit = limit;
+}
+
+void MemoryAccount::Allocate(size_t bytes) {
+    int64_t usage = this->current.fetch_add((int64_t) bytes) + (int64_t) bytes;
+
+    // Update peak if other thread didn't set bigger one
+    int64_t old_peak = this->peak.load();
+    while (usage > old_peak && !this->peak.compare_exchange_weak(old_peak, usage)) {}
+
+    assert(this->limit == 0 || usage <= this->limit);
+}
+
+void MemoryAccount::Deallocate(size_t bytes) {
+    this->current.fetch_sub((int64_t) bytes);
+}
+
+int64_t MemoryAccount::GetCurrent() const {
+    return this->current.load();
+}
+
+int64_t MemoryAccount::GetPeak() const {
+    return this->peak.load();
+}
+
+int64_t MemoryAccount::GetLimit() const {
+    return this->limit;
+}
+
+MemoryAccount::~MemoryAccount() = default;
@@ -0,0 +1,32 @@
+#ifndef TEST_MEMORYACCOUNT_H
+#define TEST_MEMORYACCOUNT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+// MemoryAccount count bytes that allocated by BudgetAllocator
+// It remember peak usage and assert that usage never exceed limit
+// Methods are thread safe, so one account can be shared by several threads
+class MemoryAccount {
+public:
+    // Constructor, limit == 0 mean that usage isn't limited
+    explicit MemoryAccount(int64_t limit = 0);
+
+    void Allocate(size_t bytes);
+    void Deallocate(size_t bytes);
+
+    // Getters
+    int64_t GetCurrent() const;
+    int64_t GetPeak() const;
+    int64_t GetLimit() const;
+
+    ~MemoryAccount();
+private:
+    std::atomic<int64_t> current;
+    std::atomic<int64_t> peak;
+    int64_t limit;
+};
+
+
+#endif //TEST_MEMORYACCOUNT_H
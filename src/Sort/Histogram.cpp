@@ -0,0 +1,69 @@
+#include "Histogram.h"
+
+#include <algorithm>
+#include <utility>
+
+Histogram::Histogram(int64_t max_slots, MemoryAccount *account) {
+    this->max_slots = max_slots;
+    this->distinct = 0;
+    this->slots = BudgetVector<HistogramSlot>(std::min<int64_t>(HISTOGRAM_MIN_SLOTS, max_slots), HistogramSlot{0, 0},
+                                              BudgetAllocator<HistogramSlot>(account));
+}
+
+// Fibonacci hashing spread near numbers of status codes to different slots
+int64_t Histogram::Find(int32_t value) const {
+    auto mask = (uint64_t) this->slots.size() - 1;
+    uint64_t index = ((uint64_t) (uint32_t) value * 0x9E3779B97F4A7C15ull >> 32) & mask;
+    while (this->slots[index].count != 0 && this->slots[index].value != value) {
+        index = (index + 1) & mask;
+    }
+
+    return (int64_t) index;
+}
+
+bool Histogram::Add(const int32_t *values, int64_t count) {
+    for (int64_t i = 0; i < count; i++) {
+        auto& slot = this->slots[Find(values[i])];
+        if (slot.count == 0) {
+            // Table is kept at most half full
+            if (2 * (this->distinct + 1) > (int64_t) this->slots.size()) {
+                if (2 * (int64_t) this->slots.size() > this->max_slots) {
+                    return false;
+                }
+                Grow();
+                i--;
+                continue;
+            }
+            slot.value = values[i];
+            this->distinct++;
+        }
+        slot.count++;
+    }
+
+    return true;
+}
+
+void Histogram::Grow() {
+    BudgetVector<HistogramSlot> old(2 * this->slots.size(), HistogramSlot{0, 0}, this->slots.get_allocator());
+    std::swap(old, this->slots);
+
+    for (auto& slot: old) {
+        if (slot.count != 0) {
+            this->slots[Find(slot.value)] = slot;
+        }
+    }
+}
+
+int64_t Histogram::GetDistinct() const {
+    return this->distinct;
+}
+
+const BudgetVector<HistogramSlot>& Histogram::Sort() {
+    auto end = std::remove_if(this->slots.begin(), this->slots.end(), [](auto& slot) { return slot.count == 0; });
+    this->slots.erase(end, this->slots.end());
+    std::sort(this->slots.begin(), this->slots.end(), [](auto& a, auto& b) { return a.value < b.value; });
+
+    return this->slots;
+}
+
+Histogram::~Histogram() = default;
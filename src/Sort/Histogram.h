@@ -0,0 +1,50 @@
+#ifndef TEST_HISTOGRAM_H
+#define TEST_HISTOGRAM_H
+
+#include <cstdint>
+
+#include "../Memory/BudgetAllocator.h"
+
+// Size of table of new histogram, it grows twice when it is half full
+#define HISTOGRAM_MIN_SLOTS 1024
+
+// Distinct number and count of its copies, slot with count 0 is empty
+struct HistogramSlot {
+    int64_t count;
+    int32_t value;
+};
+
+// Histogram count copies of every distinct number in open addressing hash table
+// Table is at most half full, so linear probing find number in a few steps
+// If numbers don't fit max slots, Add fails and histogram can't be used any more
+class Histogram {
+public:
+    // Constructor, table never has more than max_slots slots, max_slots should be power of 2
+    // Memory of table is counted by account if it isn't nullptr
+    explicit Histogram(int64_t max_slots, MemoryAccount* account = nullptr);
+
+    // Copying prohibited
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    // Count numbers, false if there are too many distinct numbers
+    bool Add(const int32_t* values, int64_t count);
+    int64_t GetDistinct() const;
+
+    // Move all distinct numbers to the start of table and sort them, numbers can't be added after it
+    const BudgetVector<HistogramSlot>& Sort();
+
+    ~Histogram();
+private:
+    BudgetVector<HistogramSlot> slots;
+    int64_t max_slots;
+    int64_t distinct;
+
+    // Slot of number or empty slot where it should be placed
+    int64_t Find(int32_t value) const;
+    // Twice bigger table, old table is freed after numbers are moved
+    void Grow();
+};
+
+
+#endif //TEST_HISTOGRAM_H
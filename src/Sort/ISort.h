@@ -10,12 +10,14 @@ class ISort {
 public:
     // Should have method that start sorting
     virtual void Start() = 0;
+    // Should have method that write only k least numbers in sorted order
+    virtual void StartPartial(int64_t k) = 0;
 
     virtual ~ISort() { };
 protected:
     // Tape that we need to sort
     ITape* tape;
-    // Max volume of memory
+    // Max volume of memory in bytes
     int64_t M;
 };
 
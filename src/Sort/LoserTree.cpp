@@ -0,0 +1,135 @@
+#include "LoserTree.h"
+
+#include <algorithm>
+#include <utility>
+
+LoserTree::LoserTree(const std::vector<ITape*>& tapes, MemoryAccount* account, int64_t buffer_size) {
+    Init(tapes, account, buffer_size);
+    this->backward = false;
+    this->descending = false;
+    for (size_t i = 0; i < tapes.size(); i++) {
+        this->remaining[i] = tapes[i]->GetN() - tapes[i]->GetPosition();
+    }
+
+    Build();
+}
+
+LoserTree::LoserTree(const std::vector<ITape*>& tapes, const std::vector<int64_t>& lengths, MemoryAccount* account,
+                     int64_t buffer_size, bool backward, bool descending) {
+    Init(tapes, account, buffer_size);
+    this->backward = backward;
+    this->descending = descending;
+    std::copy(lengths.begin(), lengths.end(), this->remaining.begin());
+
+    Build();
+}
+
+void LoserTree::Init(const std::vector<ITape*>& tapes, MemoryAccount* account, int64_t buffer_size) {
+    auto k = tapes.size();
+
+    this->tapes = BudgetVector<ITape*>(tapes.begin(), tapes.end(), BudgetAllocator<ITape*>(account));
+    this->keys = BudgetVector<int32_t>(k, 0, BudgetAllocator<int32_t>(account));
+    this->remaining = BudgetVector<int64_t>(k, 0, BudgetAllocator<int64_t>(account));
+    this->done = BudgetVector<bool>(k, false, BudgetAllocator<bool>(account));
+    this->tree = BudgetVector<int64_t>(BudgetAllocator<int64_t>(account));
+
+    this->buffer_size = std::max<int64_t>(0, buffer_size);
+    this->buffer = BudgetVector<int32_t>(k * this->buffer_size, 0, BudgetAllocator<int32_t>(account));
+    this->buffer_begin = BudgetVector<int32_t>(this->buffer_size > 0 ? k : 0, 0, BudgetAllocator<int32_t>(account));
+    this->buffer_end = BudgetVector<int32_t>(this->buffer_size > 0 ? k : 0, 0, BudgetAllocator<int32_t>(account));
+}
+
+void LoserTree::Build() {
+    auto k = (int64_t) this->tapes.size();
+    for (int64_t i = 0; i < k; i++) {
+        Fetch(i);
+    }
+
+    // Fill tree with virtual tape K that win every match, so real tapes can be added one by one
+    this->tree.assign(k > 0 ? k : 1, k);
+    for (int64_t i = k - 1; i >= 0; i--) {
+        Adjust(i);
+    }
+}
+
+bool LoserTree::Empty() const {
+    return this->tapes.empty() || this->done[this->tree[0]];
+}
+
+int32_t LoserTree::Top() const {
+    return this->keys[this->tree[0]];
+}
+
+void LoserTree::Pop() {
+    int64_t winner = this->tree[0];
+
+    this->remaining[winner]--;
+    if (this->buffer_size > 0) {
+        this->buffer_begin[winner]++;
+    } else if (!this->backward) {
+        this->tapes[winner]->ShiftLeft();
+    }
+    Fetch(winner);
+    Adjust(winner);
+}
+
+// Read number under head of tape or take next number from its buffer
+// Empty buffer is filled by one bulk read, it never read numbers after the end of run
+void LoserTree::Fetch(int64_t index) {
+    this->done[index] = this->remaining[index] <= 0;
+    if (this->done[index]) {
+        return;
+    }
+
+    if (this->buffer_size == 0) {
+        // Backward reading take number before the head
+        if (this->backward) {
+            this->tapes[index]->ShiftRight();
+        }
+        this->keys[index] = this->tapes[index]->Read();
+        return;
+    }
+
+    int32_t* buffer = this->buffer.data() + index * this->buffer_size;
+    if (this->buffer_begin[index] == this->buffer_end[index]) {
+        this->buffer_begin[index] = 0;
+        int64_t count = std::min(this->buffer_size, this->remaining[index]);
+        if (this->backward) {
+            this->buffer_end[index] = (int32_t) this->tapes[index]->ReadBlockBackward(buffer, count);
+        } else {
+            this->buffer_end[index] = (int32_t) this->tapes[index]->ReadBlock(buffer, count);
+        }
+    }
+    this->keys[index] = buffer[this->buffer_begin[index]];
+}
+
+// Tape that was read to the end lose to every tape, equal numbers are taken from tape with less index
+bool LoserTree::Less(int64_t a, int64_t b) const {
+    auto k = (int64_t) this->tapes.size();
+    if (a == k || b == k) {
+        return a == k;
+    }
+    if (this->done[a] || this->done[b]) {
+        return !this->done[a] && this->done[b];
+    }
+    if (this->keys[a] != this->keys[b]) {
+        return this->descending ? this->keys[a] > this->keys[b] : this->keys[a] < this->keys[b];
+    }
+    return a < b;
+}
+
+void LoserTree::Adjust(int64_t leaf) {
+    auto k = (int64_t) this->tapes.size();
+    int64_t winner = leaf;
+
+    for (int64_t node = (leaf + k) / 2; node > 0; node /= 2) {
+        // Node keep loser and winner go to the next match
+        if (Less(this->tree[node], winner)) {
+            std::swap(this->tree[node], winner);
+        }
+    }
+
+    this->tree[0] = winner;
+}
+
+LoserTree::~LoserTree() = default;
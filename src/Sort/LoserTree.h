@@ -0,0 +1,69 @@
+#ifndef TEST_LOSERTREE_H
+#define TEST_LOSERTREE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "../Tape/ITape.h"
+#include "../Memory/BudgetAllocator.h"
+
+// LoserTree choose the least number from heads of K sorted tapes
+// Tapes can be read backward from the head, then descending order make the greatest number win
+// Every inner node store index of tape that lost the match in this node, winner go up
+// After winner is taken only matches on the path from its leaf to the root are replayed,
+// so every number cost log2(K) comparisons
+class LoserTree {
+public:
+    // Constructor, tapes should be sorted and their heads should be at the start of the run
+    // Tapes are read to the end
+    // Memory of tree is counted by account if it isn't nullptr
+    // If buffer_size > 0 tapes are read by blocks of buffer_size numbers, else number by number
+    explicit LoserTree(const std::vector<ITape*>& tapes, MemoryAccount* account = nullptr, int64_t buffer_size = 0);
+    // Only lengths[i] numbers are read from tape i, so run can be followed by other runs on the same tape
+    // If backward is set runs are read from right to left and they end under the head
+    // If descending is set numbers are read in descending order and the greatest number is taken first
+    LoserTree(const std::vector<ITape*>& tapes, const std::vector<int64_t>& lengths, MemoryAccount* account = nullptr,
+              int64_t buffer_size = 0, bool backward = false, bool descending = false);
+
+    // All tapes are read to the end
+    bool Empty() const;
+    // Least number of all tapes, or the greatest one in descending order
+    int32_t Top() const;
+    // Take least number and read next number from the same tape
+    void Pop();
+
+    ~LoserTree();
+private:
+    BudgetVector<ITape*> tapes;
+    // Current number of every tape
+    BudgetVector<int32_t> keys;
+    // Count of numbers that left in run of every tape
+    BudgetVector<int64_t> remaining;
+    // Tape was read to the end of run
+    BudgetVector<bool> done;
+    // tree[0] - winner, tree[1..K-1] - losers
+    BudgetVector<int64_t> tree;
+    bool backward;
+    bool descending;
+
+    // Numbers that were read from tape i are buffer[i*buffer_size + buffer_begin[i] .. i*buffer_size + buffer_end[i])
+    int64_t buffer_size;
+    BudgetVector<int32_t> buffer;
+    BudgetVector<int32_t> buffer_begin;
+    BudgetVector<int32_t> buffer_end;
+
+    // Create vectors with account
+    void Init(const std::vector<ITape*>& tapes, MemoryAccount* account, int64_t buffer_size);
+
+    // Read first numbers and build tree
+    void Build();
+    // Compare two tapes, index K mean tape that is less than all others
+    bool Less(int64_t a, int64_t b) const;
+    // Replay matches from leaf to root
+    void Adjust(int64_t leaf);
+    // Read number under head of tape
+    void Fetch(int64_t index);
+};
+
+
+#endif //TEST_LOSERTREE_H
@@ -0,0 +1,245 @@
+#include "MemoryPlan.h"
+#include "Sort.h"
+#include "RadixSort.h"
+#include "../Tape/Tape.h"
+#include "../Tape/BinaryTape.h"
+
+#include <algorithm>
+#include <sstream>
+
+MemoryPlan::MemoryPlan(int64_t M, const SortSettings& settings) {
+    this->limit = M;
+
+    // Replacement selection heap keep run number with every value
+    this->element_size = settings.GetRunGeneration() == RunGeneration::ReplacementSelection
+            ? (int64_t) sizeof(int64_t) : (int64_t) sizeof(int32_t);
+
+    // Balanced merge write run to one tape and every concurrent merge merge at least 2 tapes to third one
+    // Polyphase and backward merges keep all their tapes opened while the last merge write to output tape
+    if (settings.GetMergeMode() != MergeMode::Balanced) {
+        this->run_tapes = settings.GetTempTapes();
+        this->merge_tapes = settings.GetTempTapes() + 1;
+        this->idle_tapes = 1;
+    } else {
+        this->run_tapes = 1;
+        this->merge_tapes = 3 * settings.GetDrives();
+        this->idle_tapes = 0;
+    }
+
+    // Distribution sort keep output tape opened while bucket tape is read to memory
+    if (settings.GetStrategy() == SortStrategy::Distribution) {
+        this->run_tapes = std::max<int64_t>(this->run_tapes, 2);
+    }
+
+    // Prefetching tape keep buffer of block size in addition to block
+    this->tape_buffers = settings.GetPrefetch() ? 1 + PREFETCH_CELL_BYTES / CELL_SIZE : 1;
+
+    // Blocks take at most half of memory
+    int64_t block = M / 2 / (this->merge_tapes * this->tape_buffers * CELL_SIZE);
+    this->block_size = (int32_t) std::clamp<int64_t>(block, 1, DEFAULT_BLOCK_SIZE);
+    int64_t tape_bytes = GetTapeBytes();
+
+    // Pipeline of chunk run generation need buffer for every sort thread, one for reader and one for writer
+    this->run_buffers = 1;
+    if (settings.GetRunGeneration() == RunGeneration::Chunk && settings.GetSortThreads() > 0 &&
+        settings.GetStrategy() == SortStrategy::Merge) {
+        this->run_buffers = settings.GetSortThreads() + 2;
+    }
+
+    // The rest of memory is run generation buffers
+    int64_t available = M - this->run_tapes * tape_bytes;
+    this->run_buffer = std::max<int64_t>(1, available / (this->element_size * this->run_buffers));
+
+    // Radix sort take scratch buffer for every sort thread, it is used if chunks stay long enough
+    this->scratch_buffers = 0;
+    this->radix_sort = false;
+    if (settings.GetRunGeneration() == RunGeneration::Chunk && settings.GetSortKernel() == SortKernel::Radix) {
+        int64_t scratch_buffers = std::max(1, settings.GetSortThreads());
+        int64_t radix_buffer = available / (this->element_size * (this->run_buffers + scratch_buffers));
+        if (radix_buffer >= RADIX_MIN_SIZE) {
+            this->run_buffer = radix_buffer;
+            this->scratch_buffers = scratch_buffers;
+            this->radix_sort = true;
+        }
+    }
+
+    // Natural runs are merged through scratch buffer of run buffer size
+    if (settings.GetRunGeneration() == RunGeneration::Natural) {
+        this->scratch_buffers = 1;
+        this->run_buffer = std::max<int64_t>(1, available / (this->element_size * (this->run_buffers + 1)));
+    }
+
+    // Every merged tape need block and loser tree node, one more block is for output tape
+    // Concurrent merges share memory, so there is less merges than drives if M can't keep them all
+    this->merge_threads = 1;
+    if (settings.GetMergeMode() != MergeMode::Balanced) {
+        this->fan_in = settings.GetTempTapes() - 1;
+    } else {
+        int64_t two_way = 3 * tape_bytes + 2 * LOSER_TREE_WAY_BYTES;
+        this->merge_threads = std::clamp<int64_t>(M / two_way, 1, settings.GetDrives());
+        this->fan_in = std::max<int64_t>(2, (M / this->merge_threads - tape_bytes) /
+                                            (tape_bytes + LOSER_TREE_WAY_BYTES));
+    }
+
+    // Every merged tape and output tape get buffer of the same size
+    int64_t merge = (this->fan_in + 1 + this->idle_tapes) * tape_bytes + this->fan_in * LOSER_TREE_WAY_BYTES;
+    int64_t left = std::min(M / this->merge_threads - merge, M - this->merge_tapes * tape_bytes);
+    int64_t way = (this->fan_in + 1) * CELL_SIZE + this->fan_in * MERGE_BUFFER_WAY_BYTES;
+    this->merge_buffer = std::clamp<int64_t>(left / way, 0, this->block_size);
+
+    // Every bucket tape get block and buffer of merged tape, reader of scattered tape get one more buffer
+    // Scattered bucket and output tape stay opened while buckets of the next level are written
+    // If there can't be two buckets, numbers are merged
+    this->buckets = 0;
+    if (settings.GetStrategy() == SortStrategy::Distribution) {
+        int64_t bucket = tape_bytes + this->merge_buffer * CELL_SIZE;
+        int64_t buckets = (M - 2 * tape_bytes - this->merge_buffer * CELL_SIZE) / bucket;
+        this->buckets = buckets >= 2 ? buckets : 0;
+    }
+
+    // Histogram share memory with output tape and buffer of block size that read input and write output
+    this->histogram_slots = 0;
+    if (settings.GetCounting()) {
+        int64_t slots = (M - tape_bytes - this->block_size * CELL_SIZE) * 2 / (3 * HISTOGRAM_SLOT_BYTES);
+        for (int64_t size = 2; size <= slots; size *= 2) {
+            this->histogram_slots = size;
+        }
+    }
+
+    // Heap of partial sort share memory with output tape and buffer of block size that read input
+    this->selection_heap = std::max<int64_t>(1, (M - tape_bytes - this->block_size * CELL_SIZE) / CELL_SIZE);
+}
+
+MemoryPlan::MemoryPlan() {
+    this->limit = 0;
+    this->block_size = DEFAULT_BLOCK_SIZE;
+    this->run_buffer = 0;
+    this->run_buffers = 1;
+    this->scratch_buffers = 0;
+    this->radix_sort = false;
+    this->element_size = sizeof(int32_t);
+    this->fan_in = 2;
+    this->merge_threads = 1;
+    this->merge_buffer = 0;
+    this->buckets = 0;
+    this->histogram_slots = 0;
+    this->selection_heap = 1;
+    this->tape_buffers = 1;
+    this->run_tapes = 1;
+    this->merge_tapes = 3;
+    this->idle_tapes = 0;
+}
+
+int64_t MemoryPlan::GetMemoryLimit() const {
+    return this->limit;
+}
+
+int32_t MemoryPlan::GetBlockSize() const {
+    return this->block_size;
+}
+
+int64_t MemoryPlan::GetRunBuffer() const {
+    return this->run_buffer;
+}
+
+int64_t MemoryPlan::GetRunBuffers() const {
+    return this->run_buffers;
+}
+
+int64_t MemoryPlan::GetScratchBuffers() const {
+    return this->scratch_buffers;
+}
+
+bool MemoryPlan::GetRadixSort() const {
+    return this->radix_sort;
+}
+
+int64_t MemoryPlan::GetRunBufferBytes() const {
+    return this->run_buffer * this->element_size * (this->run_buffers + this->scratch_buffers);
+}
+
+int64_t MemoryPlan::GetFanIn() const {
+    return this->fan_in;
+}
+
+int64_t MemoryPlan::GetMergeThreads() const {
+    return this->merge_threads;
+}
+
+int64_t MemoryPlan::GetMergeBuffer() const {
+    return this->merge_buffer;
+}
+
+int64_t MemoryPlan::GetBuckets() const {
+    return this->buckets;
+}
+
+int64_t MemoryPlan::GetHistogramSlots() const {
+    return this->histogram_slots;
+}
+
+int64_t MemoryPlan::GetSelectionHeap() const {
+    return this->selection_heap;
+}
+
+// Memory of one opened tape
+int64_t MemoryPlan::GetTapeBytes() const {
+    return (int64_t) this->block_size * CELL_SIZE * this->tape_buffers;
+}
+
+int64_t MemoryPlan::GetRunGenerationBytes() const {
+    return this->run_tapes * GetTapeBytes() + GetRunBufferBytes();
+}
+
+// Every merge need block for every tape and loser tree, copy of the only run need blocks of run and output tapes
+int64_t MemoryPlan::GetMergeBytes() const {
+    int64_t tape_bytes = GetTapeBytes();
+    int64_t merge = this->merge_threads *
+            ((this->fan_in + 1) * (tape_bytes + this->merge_buffer * CELL_SIZE) + this->idle_tapes * tape_bytes +
+             this->fan_in * (LOSER_TREE_WAY_BYTES + MERGE_BUFFER_WAY_BYTES * (this->merge_buffer > 0)));
+
+    return std::max(merge, this->merge_tapes * tape_bytes + this->merge_buffer * CELL_SIZE);
+}
+
+// Bucket tapes with buffers, scattered tape with read buffer and output tape
+int64_t MemoryPlan::GetDistributionBytes() const {
+    return (this->buckets + 2) * GetTapeBytes() + (this->buckets + 1) * this->merge_buffer * CELL_SIZE;
+}
+
+// Histogram grow from half of max slots, output tape and buffer of block size
+int64_t MemoryPlan::GetCountingBytes() const {
+    return this->histogram_slots * 3 / 2 * HISTOGRAM_SLOT_BYTES + GetTapeBytes() + this->block_size * CELL_SIZE;
+}
+
+bool MemoryPlan::Fits() const {
+    return GetRunGenerationBytes() <= this->limit && GetMergeBytes() <= this->limit;
+}
+
+std::string MemoryPlan::Report() const {
+    std::stringstream report;
+
+    report << "Memory limit: " << this->limit << " bytes" << std::endl;
+    report << "Tape block: " << this->block_size << " numbers (" << this->block_size * CELL_SIZE << " bytes)"
+           << (this->tape_buffers > 1 ? " and prefetch buffer of the same size with times of numbers" : "") << std::endl;
+    report << "Run generation: " << this->run_buffers + this->scratch_buffers << " x " << this->run_buffer << " numbers ("
+           << GetRunBufferBytes() << " bytes) + "
+           << this->run_tapes << " tape blocks = " << GetRunGenerationBytes() << " bytes" << std::endl;
+    report << "Chunk sort: " << (GetRadixSort() ? "radix sort" : this->scratch_buffers > 0 ? "natural merge" : "std::sort")
+           << std::endl;
+    report << "Merge: " << this->merge_threads << " x fan-in " << this->fan_in << ", buffer " << this->merge_buffer
+           << " numbers = " << GetMergeBytes() << " bytes" << std::endl;
+    if (this->buckets > 0) {
+        report << "Distribution: " << this->buckets << " buckets = " << GetDistributionBytes() << " bytes" << std::endl;
+    }
+    if (this->histogram_slots > 0) {
+        report << "Counting: " << this->histogram_slots / 2 << " distinct numbers = " << GetCountingBytes() << " bytes"
+               << std::endl;
+    }
+    if (!Fits()) {
+        report << "Memory limit is too small for sort" << std::endl;
+    }
+
+    return report.str();
+}
+
+MemoryPlan::~MemoryPlan() = default;
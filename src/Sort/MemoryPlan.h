@@ -0,0 +1,100 @@
+#ifndef TEST_MEMORYPLAN_H
+#define TEST_MEMORYPLAN_H
+
+#include <cstdint>
+#include <string>
+
+// Memory that loser tree need for every merged tape: tape pointer, number, run length, tree node and flag
+#define LOSER_TREE_WAY_BYTES 32
+// Memory that loser tree need for every merged tape to keep buffer of bulk read: position and count of numbers
+#define MERGE_BUFFER_WAY_BYTES 8
+// Memory of one cell of prefetch buffer: number and time of Clock when it was given to other thread
+#define PREFETCH_CELL_BYTES 12
+// Memory of one slot of histogram: count and number
+#define HISTOGRAM_SLOT_BYTES 16
+
+class SortSettings;
+
+// MemoryPlan split memory limit M (in bytes) between parts of sort
+// 1. Block buffer of every tape, at most half of M is spent on blocks in any step
+//    Prefetching tape have buffer of block size in addition to block, every its cell keep time of Clock too
+// 2. Numbers that run generation keep in memory, pipeline of run generation split them to several buffers
+//    Radix sort need scratch buffer for every sort thread, if runs become too short for it std::sort is used
+//    Natural run generation merge runs of chunk through one scratch buffer
+// 3. Count of tapes that merged at once (fan-in), every tape need block and loser tree node
+//    Balanced merge run merges of one round concurrently, at most one merge for every drive
+// 4. Memory that left after merge is given to buffers of bulk reads and writes of merge
+// 5. Distribution sort scatter numbers to bucket tapes with merge buffers, count of buckets is limited by M
+// 6. Counting sort keep histogram of distinct numbers, table of histogram and the twice bigger one
+//    take memory at once while it grows
+// 7. Partial sort keep heap of the least numbers with output tape and buffer of block size
+// Input tape is created by user, so its block isn't included to plan
+// Plan count buffers that grow with M, small data that isn't counted by memory account isn't included too:
+// - scratch buffers of text and compressed tapes (MOVE_BUFFER_SIZE, TEXT_BUFFER_SIZE) that live during one operation
+// - indexes of text and compressed tapes, they take a few bytes for INDEX_STRIDE numbers or for a block
+// - splitters, counters and tape pointers of distribution, 28 bytes for bucket that take block of tape in addition,
+//   they are kept for every level while bucket is distributed again
+class MemoryPlan {
+public:
+    // Constructors
+    MemoryPlan(int64_t M, const SortSettings& settings);
+    MemoryPlan();
+
+    // Getters
+    int64_t GetMemoryLimit() const;
+    int32_t GetBlockSize() const;
+    int64_t GetRunBuffer() const;
+    int64_t GetRunBuffers() const;
+    int64_t GetScratchBuffers() const;
+    bool GetRadixSort() const;
+    int64_t GetRunBufferBytes() const;
+    int64_t GetFanIn() const;
+    int64_t GetMergeThreads() const;
+    int64_t GetMergeBuffer() const;
+    int64_t GetBuckets() const;
+    int64_t GetHistogramSlots() const;
+    int64_t GetSelectionHeap() const;
+    int64_t GetTapeBytes() const;
+    int64_t GetRunGenerationBytes() const;
+    int64_t GetMergeBytes() const;
+    int64_t GetDistributionBytes() const;
+    int64_t GetCountingBytes() const;
+
+    // All steps of sort fit to memory limit
+    bool Fits() const;
+
+    // Text description of plan
+    std::string Report() const;
+
+    ~MemoryPlan();
+private:
+    int64_t limit;
+    int32_t block_size;
+    // Count of numbers and size of one number in run generation buffer, count of such buffers
+    int64_t run_buffer;
+    int64_t run_buffers;
+    // Count of scratch buffers of run buffer size for radix sort or merge of natural runs, 0 for std::sort
+    int64_t scratch_buffers;
+    bool radix_sort;
+    int64_t element_size;
+    int64_t fan_in;
+    int64_t merge_threads;
+    // Count of numbers in buffer of every merged tape, 0 if merge read and write numbers one by one
+    int64_t merge_buffer;
+    // Count of bucket tapes that distribution sort write at once, 0 if merge strategy is used
+    int64_t buckets;
+    // Max count of slots of histogram, power of 2, 0 if numbers aren't counted
+    int64_t histogram_slots;
+    // Count of numbers that partial sort select by one pass over input
+    int64_t selection_heap;
+    // Count of buffers of block size that every tape have
+    int64_t tape_buffers;
+    // Count of tapes that opened at once in run generation and merge
+    int64_t run_tapes;
+    int64_t merge_tapes;
+    // Count of tapes that stay opened without reading while the last merge write to output tape
+    int64_t idle_tapes;
+};
+
+
+#endif //TEST_MEMORYPLAN_H
@@ -0,0 +1,232 @@
+#include "PolyphaseMerge.h"
+#include "LoserTree.h"
+#include "../Tape/BlockWriter.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+PolyphaseMerge::PolyphaseMerge(const std::vector<ITape*>& tapes, MemoryAccount* account, int64_t buffer_size,
+                               bool backward) {
+    this->tapes = tapes;
+    this->account = account;
+    this->buffer_size = buffer_size;
+    this->backward = backward;
+    auto t = (int64_t) tapes.size();
+
+    // First level: one run on every input tape, output tape is empty
+    this->runs.resize(t);
+    this->perfect.assign(t, 1);
+    this->dummy.assign(t, 1);
+    this->perfect[t - 1] = 0;
+    this->dummy[t - 1] = 0;
+
+    this->level = 1;
+    // No run was written yet
+    this->current = -1;
+
+    this->expected = this->perfect;
+    this->first_descending = false;
+    this->stats = nullptr;
+}
+
+// Distribution of count runs is done without writing, so perfect distribution of the last level is known
+// Then phases are counted: every merge take one run from every input tape, so directions of runs that are merged
+// together alternate with every merge. Direction of the first merged runs is chosen so that the last merge
+// read descending runs backward and write ascending result
+void PolyphaseMerge::Expect(int64_t count) {
+    auto t = (int64_t) this->tapes.size();
+    auto perfect = this->perfect;
+    auto dummy = this->dummy;
+    auto level = this->level;
+    auto current = this->current;
+
+    for (int64_t i = 0; i < count; i++) {
+        NextTape();
+        this->dummy[this->current]--;
+    }
+    this->expected = this->perfect;
+
+    // Count merges of all phases except the last one
+    std::vector<int64_t> runs = this->perfect;
+    int64_t merges = 0;
+    for (int64_t l = this->level; l > 1; l--) {
+        int64_t phase = runs[t - 2];
+        for (int64_t j = 0; j < t - 1; j++) {
+            runs[j] -= phase;
+        }
+        runs[t - 1] += phase;
+        merges += phase;
+        std::rotate(runs.begin(), runs.end() - 1, runs.end());
+    }
+    this->first_descending = merges % 2 == 0;
+
+    this->perfect = perfect;
+    this->dummy = dummy;
+    this->level = level;
+    this->current = current;
+}
+
+// Runs are written to the tape that has most dummy runs, so dummy runs are spread over all tapes
+ITape *PolyphaseMerge::BeginRun() {
+    NextTape();
+
+    return this->tapes[this->current];
+}
+
+void PolyphaseMerge::NextTape() {
+    auto t = (int64_t) this->tapes.size();
+
+    if (this->current < 0) {
+        this->current = 0;
+    } else if (this->dummy[this->current] < this->dummy[this->current + 1]) {
+        this->current++;
+    } else {
+        // All dummy runs of level are replaced with real runs, go to the next level
+        if (this->dummy[this->current] == 0) {
+            this->level++;
+            int64_t first = this->perfect[0];
+            for (int64_t j = 0; j < t - 1; j++) {
+                this->dummy[j] = first + this->perfect[j + 1] - this->perfect[j];
+                this->perfect[j] = first + this->perfect[j + 1];
+            }
+        }
+        this->current = 0;
+    }
+}
+
+// Dummy runs of tape are merged before real ones and real runs are read from the last one,
+// so run is merged after expected-1-i runs of the same tape, where i is number of run on tape
+bool PolyphaseMerge::IsRunDescending() const {
+    if (!this->backward) {
+        return false;
+    }
+
+    int64_t merged_before = this->expected[this->current] - 1 - (int64_t) this->runs[this->current].size();
+    return this->first_descending != (merged_before % 2 == 1);
+}
+
+void PolyphaseMerge::EndRun(int64_t length) {
+    this->runs[this->current].push_back(Run{length, IsRunDescending()});
+    this->dummy[this->current]--;
+}
+
+// Dummy runs are stored as empty runs, forward merge take them first,
+// backward merge read runs from the end of tape, so dummy runs are put there
+// Then every merge take one run from every input tape and dummy runs stay in their places on output tape
+// At the last level every input tape has one run, so the last phase is one merge that can write to output tape
+ITape *PolyphaseMerge::Merge(ITape* output) {
+    auto t = (int64_t) this->tapes.size();
+
+    for (int64_t j = 0; j < t; j++) {
+        for (; this->dummy[j] > 0; this->dummy[j]--) {
+            if (this->backward) {
+                this->runs[j].push_back(Run{0, false});
+            } else {
+                this->runs[j].push_front(Run{0, false});
+            }
+        }
+    }
+
+    if (!this->backward) {
+        for (auto tape: this->tapes) {
+            tape->Rewind();
+        }
+    }
+
+    while (this->level > 0) {
+        if (this->stats != nullptr) {
+            this->stats->BeginPhase("merge_phase");
+        }
+
+        // Merge until the last input tape become empty
+        ITape* merged = this->level == 1 && output != nullptr ? output : this->tapes[t - 1];
+        while (!this->runs[t - 2].empty()) {
+            MergeRuns(merged);
+        }
+        this->level--;
+
+        // Output tape become input tape and empty tape become output one
+        // Backward reading leave head of empty tape in the start, so tapes aren't rewound
+        if (!this->backward) {
+            this->tapes[t - 1]->Rewind();
+            this->tapes[t - 2]->Rewind();
+        }
+        this->tapes[t - 2]->Truncate();
+
+        std::rotate(this->tapes.begin(), this->tapes.end() - 1, this->tapes.end());
+        std::rotate(this->runs.begin(), this->runs.end() - 1, this->runs.end());
+
+        if (this->stats != nullptr) {
+            this->stats->EndPhase(CountRuns());
+            this->stats->AddMergePass();
+        }
+    }
+
+    return output != nullptr ? output : this->tapes[0];
+}
+
+void PolyphaseMerge::SetStats(SortStats *stats) {
+    this->stats = stats;
+}
+
+int64_t PolyphaseMerge::CountRuns() const {
+    int64_t count = 0;
+    for (auto& tape_runs: this->runs) {
+        count += std::count_if(tape_runs.begin(), tape_runs.end(), [](const Run& run) { return run.length > 0; });
+    }
+
+    return count;
+}
+
+void PolyphaseMerge::MergeRuns(ITape* output) {
+    auto t = (int64_t) this->tapes.size();
+
+    // Forward merge take the first run of tape, backward merge take the last one, dummy runs are skipped
+    std::vector<ITape*> inputs;
+    std::vector<int64_t> lengths;
+    std::vector<bool> directions;
+    int64_t length = 0;
+    for (int64_t j = 0; j < t - 1; j++) {
+        Run run = this->backward ? this->runs[j].back() : this->runs[j].front();
+        if (this->backward) {
+            this->runs[j].pop_back();
+        } else {
+            this->runs[j].pop_front();
+        }
+
+        if (run.length > 0) {
+            inputs.push_back(this->tapes[j]);
+            lengths.push_back(run.length);
+            directions.push_back(run.descending);
+            length += run.length;
+        }
+    }
+
+    // If all input tapes have dummy run, output is dummy run too
+    if (inputs.empty()) {
+        this->runs[t - 1].push_back(Run{0, false});
+        return;
+    }
+
+    // Runs are read in descending order if they are ascending and read backward or descending and read forward
+    if (std::count(directions.begin(), directions.end(), directions[0]) != (int64_t) directions.size()) {
+        throw std::logic_error("Runs of one merge have different directions, count of runs wasn't expected");
+    }
+    bool descending = directions[0] != this->backward;
+
+    BlockWriter writer(output, this->buffer_size, this->account);
+    LoserTree tree(inputs, lengths, this->account, this->buffer_size, this->backward, descending);
+    while (!tree.Empty()) {
+        writer.Write(tree.Top());
+        tree.Pop();
+    }
+    writer.Flush();
+
+    this->runs[t - 1].push_back(Run{length, descending});
+}
+
+PolyphaseMerge::~PolyphaseMerge() {
+    for (auto tape: this->tapes) {
+        delete tape;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef TEST_POLYPHASEMERGE_H
+#define TEST_POLYPHASEMERGE_H
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+
+#include "../Tape/ITape.h"
+#include "../Memory/MemoryAccount.h"
+#include "SortStats.h"
+
+// PolyphaseMerge sort runs with fixed count of tapes T
+// Runs are distributed on T-1 tapes by generalized Fibonacci numbers, missing runs are filled by dummy runs
+// Every phase merge runs of T-1 tapes to the last tape until one of input tapes become empty,
+// then empty tape become output tape of the next phase
+// It's algorithm D from D. Knuth "The Art of Computer Programming" vol. 3, 5.4.2
+//
+// Backward merge never rewind tapes: runs are read from right to left starting from the head where they were written
+// Merge of runs that are read backward write run of other direction, so runs on every tape alternate ascending and
+// descending, direction of every initial run is chosen from count of runs that is given before distribution
+// (D. Knuth, 5.4.4)
+class PolyphaseMerge {
+public:
+    // Constructor, tapes should be empty and they are deleted by PolyphaseMerge
+    // Memory of loser tree is counted by account
+    // Merged tapes are read and written by blocks of buffer_size numbers, 0 - number by number
+    // If backward is set tapes are read backward and Expect should be called before distribution
+    PolyphaseMerge(const std::vector<ITape*>& tapes, MemoryAccount* account, int64_t buffer_size = 0,
+                   bool backward = false);
+
+    // Count of runs that will be distributed, backward merge choose direction of runs by it
+    void Expect(int64_t count);
+
+    // Distribution of runs
+    // Run should be written to returned tape in direction of IsRunDescending and finished by EndRun
+    ITape* BeginRun();
+    bool IsRunDescending() const;
+    void EndRun(int64_t length);
+
+    // Merge all runs, return tape that store sorted numbers
+    // If output is set the last merge write to it, so result isn't copied from temp tape and output is returned
+    // Result is ascending, backward merge leave head of result in its end
+    ITape* Merge(ITape* output = nullptr);
+
+    // Every phase of merge is added to stats, nullptr - phases aren't measured
+    void SetStats(SortStats* stats);
+
+    ~PolyphaseMerge();
+private:
+    // Run on tape, dummy run has zero length
+    struct Run {
+        int64_t length;
+        bool descending;
+    };
+
+    std::vector<ITape*> tapes;
+    // Runs that stored on every tape in order of writing, dummy runs are added to them when merge start
+    std::vector<std::deque<Run>> runs;
+    // Perfect distribution of current level and count of dummy runs of every tape
+    std::vector<int64_t> perfect;
+    std::vector<int64_t> dummy;
+    // Level of distribution and tape that get next run
+    int64_t level;
+    int64_t current;
+    MemoryAccount* account;
+    int64_t buffer_size;
+
+    bool backward;
+    // Perfect distribution that is reached when all expected runs are written
+    std::vector<int64_t> expected;
+    // Direction of runs that are merged first
+    bool first_descending;
+    SortStats* stats;
+
+    // Choose tape for next run
+    void NextTape();
+    // Merge one run from every input tape to output tape
+    void MergeRuns(ITape* output);
+    // Count of real runs on all tapes
+    int64_t CountRuns() const;
+};
+
+
+#endif //TEST_POLYPHASEMERGE_H
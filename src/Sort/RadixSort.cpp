@@ -0,0 +1,54 @@
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Key of number that is ordered as unsigned
+static inline uint32_t RadixKey(int32_t value) {
+    return (uint32_t) value ^ 0x80000000u;
+}
+
+void RadixSort(int32_t* data, int32_t* scratch, size_t n) {
+    if (n < RADIX_MIN_SIZE) {
+        std::sort(data, data + n);
+        return;
+    }
+
+    // Count all digits at once
+    size_t count[RADIX_PASSES][RADIX_BUCKETS] = {};
+    for (size_t i = 0; i < n; i++) {
+        uint32_t key = RadixKey(data[i]);
+        for (int pass = 0; pass < RADIX_PASSES; pass++) {
+            count[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+        }
+    }
+
+    int32_t* from = data;
+    int32_t* to = scratch;
+    for (int pass = 0; pass < RADIX_PASSES; pass++) {
+        int shift = pass * RADIX_BITS;
+
+        // All numbers have the same digit, pass don't change order
+        if (count[pass][(RadixKey(from[0]) >> shift) & (RADIX_BUCKETS - 1)] == n) {
+            continue;
+        }
+
+        // Turn counts to offsets of buckets
+        size_t offset[RADIX_BUCKETS];
+        size_t sum = 0;
+        for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+            offset[bucket] = sum;
+            sum += count[pass][bucket];
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            to[offset[(RadixKey(from[i]) >> shift) & (RADIX_BUCKETS - 1)]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+
+    // Odd count of passes leave numbers in scratch
+    if (from != data) {
+        std::memcpy(data, from, n * sizeof(int32_t));
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef TEST_RADIXSORT_H
+#define TEST_RADIXSORT_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Radix sort use 4 digits of 8 bits
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES 4
+// Less numbers are sorted by std::sort, radix sort don't pay for its histograms on them
+#define RADIX_MIN_SIZE 256
+
+// LSD radix sort of n numbers, scratch should have place for n numbers
+// Sign bit is flipped, so negative numbers go before positive ones
+// Histograms of all digits are counted in one pass, passes where all numbers have same digit are skipped
+// Sorted numbers are always returned in data
+void RadixSort(int32_t* data, int32_t* scratch, size_t n);
+
+
+#endif //TEST_RADIXSORT_H
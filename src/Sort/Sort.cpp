@@ -1,143 +1,1012 @@
 #include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <map>
+#include <thread>
 
 #include "Sort.h"
+#include "LoserTree.h"
+#include "RadixSort.h"
+#include "Histogram.h"
+#include "../Thread/ThreadPool.h"
+#include "../Tape/Clock.h"
 #include "../Tape/Tape.h"
+#include "../Tape/BinaryTape.h"
+#include "../Tape/MmapTape.h"
+#include "../Tape/CompressedTape.h"
+#include "../Tape/PrefetchingTape.h"
+#include "../Tape/BlockWriter.h"
 
+// SortSettings constructor with settings from file
+SortSettings::SortSettings(const std::string& settingsFileName) {
+    // Try to open file
+    std::ifstream file;
+    file.open(settingsFileName);
+    if (file.is_open()) {
+        std::string line;
+
+        SortSettings settings;
+
+        // Read all lines in file and save it to settings, tape settings are skipped
+        while (std::getline(file, line)) {
+            if (!line.compare(0, 14, RUN_GENERATION_STR)) {
+                if (!line.compare(15, 21, RUN_GENERATION_REPLACEMENT_STR)) {
+                    settings.run_generation = RunGeneration::ReplacementSelection;
+                } else if (!line.compare(15, 7, RUN_GENERATION_NATURAL_STR)) {
+                    settings.run_generation = RunGeneration::Natural;
+                } else {
+                    settings.run_generation = RunGeneration::Chunk;
+                }
+            } else if (!line.compare(0, 10, MERGE_MODE_STR)) {
+                if (!line.compare(11, 9, MERGE_MODE_POLYPHASE_STR)) {
+                    settings.merge_mode = MergeMode::Polyphase;
+                } else if (!line.compare(11, 8, MERGE_MODE_BACKWARD_STR)) {
+                    settings.merge_mode = MergeMode::Backward;
+                } else {
+                    settings.merge_mode = MergeMode::Balanced;
+                }
+            } else if (!line.compare(0, 10, TEMP_TAPES_STR)) {
+                settings.SetTempTapes(stoi(line.substr(11)));
+            } else if (!line.compare(0, 12, MEMORY_LIMIT_STR)) {
+                settings.memory_limit = stoll(line.substr(13));
+            } else if (!line.compare(0, 12, SORT_THREADS_STR)) {
+                settings.SetSortThreads(stoi(line.substr(13)));
+            } else if (!line.compare(0, 8, PREFETCH_STR)) {
+                settings.prefetch = !line.compare(9, 2, PREFETCH_ON_STR);
+            } else if (!line.compare(0, 8, COUNTING_STR)) {
+                settings.counting = !line.compare(9, 2, COUNTING_ON_STR);
+            } else if (!line.compare(0, 8, STRATEGY_STR)) {
+                if (!line.compare(9, 12, STRATEGY_DISTRIBUTION_STR)) {
+                    settings.strategy = SortStrategy::Distribution;
+                } else {
+                    settings.strategy = SortStrategy::Merge;
+                }
+            } else if (!line.compare(0, 6, DRIVES_STR)) {
+                settings.SetDrives(stoi(line.substr(7)));
+            } else if (!line.compare(0, 11, SORT_KERNEL_STR)) {
+                if (!line.compare(12, 5, SORT_KERNEL_RADIX_STR)) {
+                    settings.sort_kernel = SortKernel::Radix;
+                } else {
+                    settings.sort_kernel = SortKernel::Std;
+                }
+            }
+        }
+
+        *this = settings;
+        file.close();
+        return;
+    }
+
+    // If we can't open file then use empty constructor
+    *this = SortSettings();
+}
+
+SortSettings::SortSettings() {
+    this->run_generation = RunGeneration::Chunk;
+    this->merge_mode = MergeMode::Balanced;
+    this->temp_tapes = DEFAULT_TEMP_TAPES;
+    this->memory_limit = DEFAULT_MEMORY_LIMIT;
+    this->sort_threads = 0;
+    this->sort_kernel = SortKernel::Std;
+    this->drives = 1;
+    this->prefetch = false;
+    this->output_format = TapeFormat::Text;
+    this->strategy = SortStrategy::Merge;
+    this->counting = false;
+}
+
+// Backward merge should know count of runs before they are written, so it use chunk run generation
+RunGeneration SortSettings::GetRunGeneration() const {
+    if (this->merge_mode == MergeMode::Backward) {
+        return RunGeneration::Chunk;
+    }
+    return this->run_generation;
+}
+
+MergeMode SortSettings::GetMergeMode() const {
+    return this->merge_mode;
+}
+
+int32_t SortSettings::GetTempTapes() const {
+    return this->temp_tapes;
+}
+
+int64_t SortSettings::GetMemoryLimit() const {
+    return this->memory_limit;
+}
+
+int32_t SortSettings::GetSortThreads() const {
+    return this->sort_threads;
+}
+
+SortKernel SortSettings::GetSortKernel() const {
+    return this->sort_kernel;
+}
+
+int32_t SortSettings::GetDrives() const {
+    return this->drives;
+}
+
+bool SortSettings::GetPrefetch() const {
+    return this->prefetch;
+}
+
+TapeFormat SortSettings::GetOutputFormat() const {
+    return this->output_format;
+}
+
+SortStrategy SortSettings::GetStrategy() const {
+    return this->strategy;
+}
+
+bool SortSettings::GetCounting() const {
+    return this->counting;
+}
+
+void SortSettings::SetRunGeneration(RunGeneration run_generation) {
+    this->run_generation = run_generation;
+}
+
+void SortSettings::SetMergeMode(MergeMode merge_mode) {
+    this->merge_mode = merge_mode;
+}
+
+void SortSettings::SetTempTapes(int32_t temp_tapes) {
+    this->temp_tapes = std::max(MIN_TEMP_TAPES, temp_tapes);
+}
+
+void SortSettings::SetMemoryLimit(int64_t memory_limit) {
+    this->memory_limit = memory_limit;
+}
+
+void SortSettings::SetSortThreads(int32_t sort_threads) {
+    this->sort_threads = std::max(0, sort_threads);
+}
+
+void SortSettings::SetSortKernel(SortKernel sort_kernel) {
+    this->sort_kernel = sort_kernel;
+}
+
+void SortSettings::SetDrives(int32_t drives) {
+    this->drives = std::max(1, drives);
+}
+
+void SortSettings::SetPrefetch(bool prefetch) {
+    this->prefetch = prefetch;
+}
+
+void SortSettings::SetOutputFormat(TapeFormat output_format) {
+    this->output_format = output_format;
+}
+
+void SortSettings::SetStrategy(SortStrategy strategy) {
+    this->strategy = strategy;
+}
+
+void SortSettings::SetCounting(bool counting) {
+    this->counting = counting;
+}
+
+SortSettings::~SortSettings() = default;
+
+// Sort constructor with sort settings from settings file
 Sort::Sort(ITape *tape, const std::string& out_file_name, int64_t M) {
     this->tape = tape;
     this->output_file_name = out_file_name;
     this->M = M;
+    this->settings = SortSettings(SETTINGS_PATH);
+    this->tape_settings = TapeSettings(SETTINGS_PATH);
+    this->runs = 0;
+    this->polyphase = nullptr;
+    this->plan = MemoryPlan(M, this->settings);
+    this->account = new MemoryAccount(M);
+    this->stats = new SortStats();
 }
 
-void Sort::Start() {
-    SortToTempFiles();
-    MergeTempFiles();
+Sort::Sort(ITape *tape, const std::string& out_file_name, int64_t M, const SortSettings& settings) {
+    this->tape = tape;
+    this->output_file_name = out_file_name;
+    this->M = M;
+    this->settings = settings;
+    this->tape_settings = TapeSettings(SETTINGS_PATH);
+    this->runs = 0;
+    this->polyphase = nullptr;
+    this->plan = MemoryPlan(M, this->settings);
+    this->account = new MemoryAccount(M);
+    this->stats = new SortStats();
 }
 
-std::vector<int32_t>* Sort::ReadMValues() const {
-    auto values = new std::vector<int32_t>;
+void Sort::Start() {
+    if (!this->plan.Fits()) {
+        throw std::invalid_argument(this->plan.Report());
+    }
 
-    // Read M numbers from tape or read while head not in the end of tape
-    for (int64_t i = 0; i < this->M && this->tape->GetPosition() < this->tape->GetN(); i++) {
-        values->push_back(this->tape->Read());
-        this->tape->ShiftLeft();
+    this->stats->SetN(this->tape->GetN() - this->tape->GetPosition());
+
+    if (this->stats->GetN() <= this->plan.GetRunBuffer()) {
+        this->stats->BeginPhase("direct_sort");
+        SortToOutputTape();
+        this->stats->EndPhase(this->runs);
+    } else if (this->plan.GetHistogramSlots() > 0 && CountToOutputTape()) {
+        // Input had few distinct numbers and output was written from histogram
+    } else if (this->settings.GetRunGeneration() == RunGeneration::Natural && CopySortedInput()) {
+        // Input was sorted and it's already in output tape
+    } else if (this->plan.GetBuckets() > 0) {
+        DistributionSort();
+    } else if (this->settings.GetMergeMode() != MergeMode::Balanced) {
+        PolyphaseSort();
+    } else {
+        this->stats->BeginPhase("run_generation");
+        SortToTempFiles();
+        RemoveStaleTmpFiles(0, this->runs);
+        this->stats->EndPhase(this->runs);
+
+        MergeTempFiles();
     }
 
+    this->stats->SetRuns(this->runs);
+    this->stats->SetInputStats(this->tape->GetStats());
+}
+
+const MemoryPlan &Sort::GetMemoryPlan() const {
+    return this->plan;
+}
+
+int64_t Sort::GetPeakMemory() const {
+    return this->account->GetPeak();
+}
+
+const SortStats &Sort::GetStats() const {
+    return *this->stats;
+}
+
+// Read as many numbers as run buffer of memory plan can store
+BudgetVector<int32_t>* Sort::ReadMValues() const {
+    auto values = new BudgetVector<int32_t>(BudgetAllocator<int32_t>(this->account));
+    values->reserve(this->plan.GetRunBuffer());
+    ReadValues(values);
+
     return values;
 }
 
+// Fill buffer with numbers from tape by one bulk read, capacity of buffer isn't changed
+void Sort::ReadValues(BudgetVector<int32_t>* values) const {
+    values->resize(this->plan.GetRunBuffer());
+    values->resize(this->tape->ReadBlock(values->data(), (int64_t) values->size()));
+}
+
 // Create tape method
-ITape *Sort::CreateTape(std::string file_path, std::string setting) const {
-    TapeSettings settings(setting);
-    ITape* tempTape = new Tape(file_path, settings);
+// Temp tapes use format from settings, text format is used only for input and output tapes
+// Block size is taken from memory plan and memory of block is counted by sort account
+ITape *Sort::CreateTape(std::string file_path) const {
+    TapeSettings settings = this->tape_settings;
+    settings.SetBlockSize(this->plan.GetBlockSize());
+    settings.SetMemoryAccount(this->account);
+    settings.SetStatsAccount(this->stats->GetTempAccount());
+    ITape* tempTape;
+    if (settings.GetFormat() == TapeFormat::Binary) {
+        tempTape = new BinaryTape(file_path, settings);
+    } else if (settings.GetFormat() == TapeFormat::Mmap) {
+#ifndef _WIN32
+        tempTape = new MmapTape(file_path, settings);
+#else
+        // Memory mapping is implemented only for POSIX, binary tape use the same file
+        tempTape = new BinaryTape(file_path, settings);
+#endif
+    } else if (settings.GetFormat() == TapeFormat::Compressed) {
+        tempTape = new CompressedTape(file_path, settings);
+    } else {
+        tempTape = new Tape(file_path, settings);
+    }
 
-    return tempTape;
+    return Prefetch(tempTape);
+}
+
+// Wrap tape by PrefetchingTape if it's set in settings, prefetch buffer has size of block
+ITape *Sort::Prefetch(ITape *tape) const {
+    if (!this->settings.GetPrefetch()) {
+        return tape;
+    }
+
+    return new PrefetchingTape(tape, this->plan.GetBlockSize(), this->account);
 }
 
 // Create temp tape
 // temp_folder - number of temp folder (0, 1, 2, ...)
 // number - number of file
+// If file already exist it is overwritten, so temp tapes are reused between rounds
 ITape *Sort::CreateTempTape(int64_t temp_folder, int64_t number) const {
-    // Construct path to file
-    std::string tmp(TMP_PATH);
-    tmp += std::to_string(temp_folder);
-    std::filesystem::create_directories(tmp);
+    std::filesystem::create_directories(GetTmpFolder(temp_folder));
+
+    auto tape = this->CreateTape(GetTempPath(temp_folder, number));
+    tape->Truncate();
 
+    return tape;
+}
+
+// Construct path to file of temp tape
+std::string Sort::GetTempPath(int64_t temp_folder, int64_t number) const {
+    std::string tmp = GetTmpFolder(temp_folder);
     tmp += "/";
     tmp += std::to_string(number);
-    tmp += std::string(".txt");
+    tmp += GetTempExtension();
+
+    return tmp;
+}
+
+// Rounds use only TMP_FOLDERS folders, round i read folder i%TMP_FOLDERS and write to the next one
+std::string Sort::GetTmpFolder(int64_t i) const {
+    std::string tmp(TMP_PATH);
+    tmp += std::to_string(i % TMP_FOLDERS);
+
+    return tmp;
+}
+
+// Remove files that left in folder from previous rounds, all files with number >= count
+void Sort::RemoveStaleTmpFiles(int64_t i, int64_t count) const {
+    if (!std::filesystem::exists(GetTmpFolder(i))) {
+        return;
+    }
+
+    auto dir_iter = Sort::GetTmpDirectoryIterator(i);
+
+    // Only files named as temp tapes are removed, other files in folder are left as they are
+    // Number of temp tape has at most 18 digits, so it always fits int64_t
+    std::string extension = GetTempExtension();
+    std::vector<std::filesystem::path> stale;
+    for (auto& entry: *dir_iter) {
+        std::string stem = entry.path().stem().string();
+        if (entry.path().extension().string() != extension || stem.empty() || stem.size() > 18 ||
+            !std::all_of(stem.begin(), stem.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+        if (std::stoll(stem) >= count) {
+            stale.push_back(entry.path());
+        }
+    }
+    for (auto& path: stale) {
+        std::filesystem::remove(path);
+    }
+
+    delete dir_iter;
+}
 
-    return this->CreateTape(tmp, SETTINGS_PATH);
+// Extension of temp tape file depends on format from settings
+std::string Sort::GetTempExtension() const {
+    if (this->tape_settings.GetFormat() == TapeFormat::Compressed) {
+        return std::string(".cmp");
+    }
+    if (this->tape_settings.GetFormat() != TapeFormat::Text) {
+        return std::string(".bin");
+    }
+
+    return std::string(".txt");
 }
 
 // Create output tape
+// Output tape is text, so it can be read by user, or binary if caller export it to text after sort
 ITape *Sort::CreateOutputTape() const {
-    return this->CreateTape(this->GetOutFileName(), SETTINGS_PATH);
+    auto tape = OpenOutputTape();
+    tape->Truncate();
+
+    return tape;
+}
+
+// Output tape with numbers that are already written to it
+ITape *Sort::OpenOutputTape() const {
+    TapeSettings settings = this->tape_settings;
+    settings.SetBlockSize(this->plan.GetBlockSize());
+    settings.SetMemoryAccount(this->account);
+    settings.SetStatsAccount(this->stats->GetOutputAccount());
+
+    ITape* out;
+    if (this->settings.GetOutputFormat() == TapeFormat::Binary) {
+        out = new BinaryTape(this->GetOutFileName(), settings);
+    } else {
+        out = new Tape(this->GetOutFileName(), settings);
+    }
+    return Prefetch(out);
+}
+
+// Write numbers to tape by one bulk write
+void Sort::WriteVectorToTape(ITape *tape, BudgetVector<int32_t>* vector) const {
+    tape->WriteBlock(vector->data(), (int64_t) vector->size());
 }
 
-// Write numbers to tape
-void Sort::WriteVectorToTape(ITape *tape, std::vector<int32_t>* vector) const {
-    for (auto n: *vector) {
-        tape->Write(n);
-        tape->ShiftLeft();
+// Get tape for next run
+// For balanced merge every run is written to new file in folder /tmp/0/, polyphase merge choose one of its tapes
+ITape *Sort::BeginRun() {
+    if (this->polyphase != nullptr) {
+        return this->polyphase->BeginRun();
     }
-    tape->Rewind();
+
+    return CreateTempTape(0, this->runs);
+}
+
+// Finish run that was written to run_tape
+void Sort::EndRun(ITape *run_tape, int64_t length) {
+    this->runs++;
+
+    if (this->polyphase != nullptr) {
+        this->polyphase->EndRun(length);
+        return;
+    }
+
+    run_tape->Rewind();
+    delete run_tape;
+}
+
+// Write sorted chunk as new run, backward merge can ask to write it in descending order
+void Sort::WriteRun(BudgetVector<int32_t>* values) {
+    auto tempTape = BeginRun();
+    if (this->polyphase != nullptr && this->polyphase->IsRunDescending()) {
+        std::reverse(values->begin(), values->end());
+    }
+    WriteVectorToTape(tempTape, values);
+    EndRun(tempTape, (int64_t) values->size());
+}
+
+// Count of runs of chunk run generation, every run except the last one fill run buffer
+int64_t Sort::CountRuns() const {
+    int64_t left = this->tape->GetN() - this->tape->GetPosition();
+    return (left + this->plan.GetRunBuffer() - 1) / this->plan.GetRunBuffer();
 }
 
 // First step of sorting
-// 1. Take M values from tape
+// 1. Take values from tape, as many as memory plan allow
 // 2. Sort it
 // 3. Write to temporary file in folder /tmp/0/
 void Sort::SortToTempFiles() {
-    for (int64_t i = 0; i*this->M < this->tape->GetN(); i++) {
-        auto values = ReadMValues();
+    if (this->settings.GetRunGeneration() == RunGeneration::ReplacementSelection) {
+        ReplacementSelectionToTempFiles();
+        return;
+    }
+    if (this->settings.GetRunGeneration() == RunGeneration::Natural) {
+        NaturalRunsToTempFiles();
+        return;
+    }
+    if (this->settings.GetSortThreads() > 0) {
+        PipelineToTempFiles();
+        return;
+    }
+
+    // Run buffer is allocated once and refilled for every chunk
+    auto values = ReadMValues();
+    auto scratch = CreateScratch();
+    while (!values->empty()) {
+        SortRun(values, scratch);
+        WriteRun(values);
+
+        ReadValues(values);
+    }
+    delete scratch;
+    delete values;
+}
+
+// Input that fit run buffer is sorted in memory and written straight to output tape, temp tapes aren't used
+void Sort::SortToOutputTape() {
+    auto values = ReadMValues();
+    auto scratch = CreateScratch();
+    if (this->settings.GetRunGeneration() == RunGeneration::Natural) {
+        scratch->resize(values->size());
+        MergeNaturalRuns(values->data(), scratch->data(), values->size());
+    } else {
+        SortRun(values, scratch);
+    }
+    delete scratch;
+
+    auto out = CreateOutputTape();
+    WriteVectorToTape(out, values);
+    delete out;
+
+    this->runs = values->empty() ? 0 : 1;
+    delete values;
+}
+
+// Sort chunk by radix sort if there is scratch buffer, otherwise by std::sort
+void Sort::SortRun(BudgetVector<int32_t>* values, BudgetVector<int32_t>* scratch) {
+    if (scratch == nullptr) {
         std::sort(values->begin(), values->end());
+        return;
+    }
+
+    // Scratch have capacity of run buffer, so resize don't allocate memory
+    scratch->resize(values->size());
+    RadixSort(values->data(), scratch->data(), values->size());
+}
+
+// Scratch buffer of radix sort or natural merge, nullptr if memory plan has no place for it
+BudgetVector<int32_t>* Sort::CreateScratch() const {
+    if (this->plan.GetScratchBuffers() == 0) {
+        return nullptr;
+    }
 
-        auto tempTape = CreateTempTape(0, i);
-        WriteVectorToTape(tempTape, values);
+    auto scratch = new BudgetVector<int32_t>(BudgetAllocator<int32_t>(this->account));
+    scratch->reserve(this->plan.GetRunBuffer());
 
-        delete tempTape;
+    return scratch;
+}
+
+// First step of sorting by pipeline of threads
+// 1. Reader thread fill free buffer with numbers from input tape and pass it to sort threads
+// 2. Sort threads sort buffers and pass them to writer
+// Every sort thread have own scratch buffer for radix sort
+// 3. Writer (this thread) write buffers to run tapes in order of reading and return buffers to free ones
+// Count of buffers is fixed by memory plan, so chunk i+1 is read while chunk i is sorted and chunk i-1 is written
+// Only writer start and end runs, so polyphase merge is used by one thread
+void Sort::PipelineToTempFiles() {
+    auto buffers = (size_t) this->plan.GetRunBuffers();
+
+    BoundedQueue<BudgetVector<int32_t>*> free_buffers(buffers);
+    for (size_t i = 0; i < buffers; i++) {
+        auto values = new BudgetVector<int32_t>(BudgetAllocator<int32_t>(this->account));
+        values->reserve(this->plan.GetRunBuffer());
+        free_buffers.Push(values);
+    }
+    BoundedQueue<RunChunk> read(buffers);
+    BoundedQueue<RunChunk> sorted(buffers);
+
+    // Threads of pipeline start at the same virtual time
+    Clock::Global().Join();
+    std::thread reader(&Sort::ReadChunks, this, std::ref(free_buffers), std::ref(read));
+    std::atomic<int32_t> sorters(this->settings.GetSortThreads());
+    std::vector<std::thread> sort_threads;
+    std::vector<BudgetVector<int32_t>*> scratches;
+    for (int32_t i = 0; i < this->settings.GetSortThreads(); i++) {
+        scratches.push_back(CreateScratch());
+        sort_threads.emplace_back(&Sort::SortChunks, std::ref(read), std::ref(sorted), std::ref(sorters),
+                                  scratches.back());
+    }
+
+    // Sort threads can finish chunks not in order, so chunks wait for their turn
+    std::map<int64_t, BudgetVector<int32_t>*> waiting;
+    int64_t next = 0;
+    RunChunk chunk{};
+    while (sorted.Pop(chunk)) {
+        waiting[chunk.number] = chunk.values;
+
+        while (!waiting.empty() && waiting.begin()->first == next) {
+            auto values = waiting.begin()->second;
+            waiting.erase(waiting.begin());
+            WriteRun(values);
+
+            free_buffers.Push(values);
+            next++;
+        }
+    }
+
+    reader.join();
+    for (auto& thread: sort_threads) {
+        thread.join();
+    }
+    Clock::Global().Join();
+    for (auto scratch: scratches) {
+        delete scratch;
+    }
+
+    free_buffers.Close();
+    BudgetVector<int32_t>* values = nullptr;
+    while (free_buffers.Pop(values)) {
         delete values;
     }
 }
 
+// Reader of pipeline, it is the only thread that use input tape
+void Sort::ReadChunks(BoundedQueue<BudgetVector<int32_t>*>& free_buffers, BoundedQueue<RunChunk>& read) const {
+    BudgetVector<int32_t>* values = nullptr;
+    for (int64_t number = 0; this->tape->GetPosition() < this->tape->GetN(); number++) {
+        free_buffers.Pop(values);
+        ReadValues(values);
+        read.Push(RunChunk{number, values});
+    }
+
+    read.Close();
+}
+
+// Sort thread of pipeline, the last finished thread close queue of writer
+void Sort::SortChunks(BoundedQueue<RunChunk>& read, BoundedQueue<RunChunk>& sorted, std::atomic<int32_t>& sorters,
+                      BudgetVector<int32_t>* scratch) {
+    RunChunk chunk{};
+    while (read.Pop(chunk)) {
+        SortRun(chunk.values, scratch);
+        sorted.Push(chunk);
+    }
+
+    if (sorters.fetch_sub(1) == 1) {
+        sorted.Close();
+    }
+}
+
+// First step of sorting by replacement selection
+// 1. Take values from tape to heap, every value is marked with number of run
+// 2. Least value of current run is written to run tape and replaced with next value from input tape
+// 3. If next value is less than written one it can't be added to current run, so it is marked for the next run
+// 4. When heap have no values of current run, next run is started
+// On random input runs are about twice longer than heap, sorted input give one run
+void Sort::ReplacementSelectionToTempFiles() {
+    // Run number is stored in high half of key and value in low one, so std::greater make heap of least run and value
+    BudgetVector<int64_t> heap(BudgetAllocator<int64_t>(this->account));
+    heap.reserve(this->plan.GetRunBuffer());
+    auto compare = std::greater<int64_t>();
+
+    for (int64_t i = 0; i < this->plan.GetRunBuffer() && this->tape->GetPosition() < this->tape->GetN(); i++) {
+        heap.push_back(HeapKey(0, this->tape->Read()));
+        this->tape->ShiftLeft();
+    }
+    std::make_heap(heap.begin(), heap.end(), compare);
+
+    int64_t run = 0;
+    int64_t length = 0;
+    ITape* run_tape = nullptr;
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), compare);
+        int64_t least_run = heap.back() >> 32;
+        int32_t least = HeapValue(heap.back());
+        heap.pop_back();
+
+        // Heap have no values of current run, start next one
+        if (run_tape == nullptr || least_run != run) {
+            if (run_tape != nullptr) {
+                EndRun(run_tape, length);
+            }
+            run = least_run;
+            run_tape = BeginRun();
+            length = 0;
+        }
+
+        run_tape->Write(least);
+        run_tape->ShiftLeft();
+        length++;
+
+        // Replace written value with next value of input tape
+        if (this->tape->GetPosition() < this->tape->GetN()) {
+            int32_t n = this->tape->Read();
+            this->tape->ShiftLeft();
+
+            heap.push_back(HeapKey(n < least ? run + 1 : run, n));
+            std::push_heap(heap.begin(), heap.end(), compare);
+        }
+    }
+    if (run_tape != nullptr) {
+        EndRun(run_tape, length);
+    }
+}
+
+// Sorted input is copied straight to output tape by run buffers, so it's read and written once
+// Copy stop at the first buffer that break order, head of input tape is moved back to the start and copied numbers
+// are read again by run generation, output tape is rewritten by the last merge
+// Return true if the whole input was copied
+bool Sort::CopySortedInput() {
+    this->stats->BeginPhase("sorted_copy");
+
+    int64_t start = this->tape->GetPosition();
+    auto values = ReadMValues();
+    ITape* out = nullptr;
+    int32_t last = INT32_MIN;
+    bool sorted = true;
+    while (!values->empty()) {
+        if (values->front() < last || !std::is_sorted(values->begin(), values->end())) {
+            sorted = false;
+            break;
+        }
+
+        if (out == nullptr) {
+            out = CreateOutputTape();
+        }
+        WriteVectorToTape(out, values);
+        last = values->back();
+
+        ReadValues(values);
+    }
+    delete out;
+
+    // Move head of input tape back by bulk reads
+    while (!sorted && this->tape->GetPosition() > start) {
+        values->resize(std::min(this->plan.GetRunBuffer(), this->tape->GetPosition() - start));
+        this->tape->ReadBlockBackward(values->data(), (int64_t) values->size());
+    }
+    delete values;
+
+    this->runs = sorted ? 1 : 0;
+    this->stats->EndPhase(this->runs);
+
+    return sorted;
+}
+
+// Count numbers of input to histogram by one pass, then write every distinct number to output tape
+// as many times as it was counted, so input with few distinct numbers is sorted without temp tapes
+// If histogram can't keep all distinct numbers, head of input is moved back and false is returned
+bool Sort::CountToOutputTape() {
+    this->stats->BeginPhase("counting");
+
+    int64_t start = this->tape->GetPosition();
+    auto histogram = new Histogram(this->plan.GetHistogramSlots(), this->account);
+    auto buffer = new BudgetVector<int32_t>(this->plan.GetBlockSize(), 0, BudgetAllocator<int32_t>(this->account));
+    bool counted = true;
+    while (counted) {
+        int64_t read = this->tape->ReadBlock(buffer->data(), (int64_t) buffer->size());
+        if (read == 0) {
+            break;
+        }
+        counted = histogram->Add(buffer->data(), read);
+    }
+
+    if (counted) {
+        auto out = CreateOutputTape();
+        int64_t size = 0;
+        for (auto& slot: histogram->Sort()) {
+            for (int64_t left = slot.count; left > 0;) {
+                int64_t count = std::min(left, (int64_t) buffer->size() - size);
+                std::fill_n(buffer->begin() + size, count, slot.value);
+                size += count;
+                left -= count;
+                if (size == (int64_t) buffer->size()) {
+                    out->WriteBlock(buffer->data(), size);
+                    size = 0;
+                }
+            }
+        }
+        if (size > 0) {
+            out->WriteBlock(buffer->data(), size);
+        }
+        delete out;
+    } else {
+        // Move head of input tape back by bulk reads
+        while (this->tape->GetPosition() > start) {
+            this->tape->ReadBlockBackward(buffer->data(), std::min((int64_t) buffer->size(),
+                                                                   this->tape->GetPosition() - start));
+        }
+    }
+    delete buffer;
+    delete histogram;
+
+    this->runs = counted ? 1 : 0;
+    this->stats->EndPhase(this->runs);
+
+    return counted;
+}
+
+// First step of sorting by natural runs
+// 1. Take values from tape, as many as memory plan allow
+// 2. Numbers from the start of chunk that keep order of open run are appended to it, so sorted input give one run
+// 3. Descending runs of the rest of chunk are reversed and all runs are merged in memory to one run
+// 4. Merged run is written to new run tape that stay open for the next chunk
+void Sort::NaturalRunsToTempFiles() {
+    auto values = ReadMValues();
+    auto scratch = CreateScratch();
+
+    ITape* run_tape = nullptr;
+    int64_t length = 0;
+    int32_t last = 0;
+    while (!values->empty()) {
+        size_t begin = 0;
+        if (run_tape != nullptr) {
+            while (begin < values->size() && (*values)[begin] >= last) {
+                last = (*values)[begin];
+                begin++;
+            }
+            run_tape->WriteBlock(values->data(), (int64_t) begin);
+            length += (int64_t) begin;
+
+            if (begin < values->size()) {
+                EndRun(run_tape, length);
+                run_tape = nullptr;
+            }
+        }
+
+        if (begin < values->size()) {
+            size_t size = values->size() - begin;
+            scratch->resize(size);
+            MergeNaturalRuns(values->data() + begin, scratch->data(), size);
+
+            run_tape = BeginRun();
+            run_tape->WriteBlock(values->data() + begin, (int64_t) size);
+            length = (int64_t) size;
+            last = values->back();
+        }
+
+        ReadValues(values);
+    }
+    if (run_tape != nullptr) {
+        EndRun(run_tape, length);
+    }
+
+    delete scratch;
+    delete values;
+}
+
+// Natural merge sort of chunk
+// Descending runs are reversed, then every pass merge pairs of neighbour runs between values and scratch
+// Chunk of r runs is sorted by log2(r) passes, sorted chunk is only scanned
+void Sort::MergeNaturalRuns(int32_t* values, int32_t* scratch, size_t size) {
+    for (size_t i = 0; i < size;) {
+        size_t j = i + 1;
+        if (j < size && values[j] < values[i]) {
+            while (j < size && values[j] < values[j - 1]) {
+                j++;
+            }
+            std::reverse(values + i, values + j);
+        } else {
+            j = NaturalRunEnd(values, i, size);
+        }
+        i = j;
+    }
+
+    int32_t* from = values;
+    int32_t* to = scratch;
+    while (NaturalRunEnd(from, 0, size) < size) {
+        for (size_t i = 0; i < size;) {
+            size_t middle = NaturalRunEnd(from, i, size);
+            size_t end = NaturalRunEnd(from, middle, size);
+            std::merge(from + i, from + middle, from + middle, from + end, to + i);
+            i = end;
+        }
+        std::swap(from, to);
+    }
+
+    if (from != values) {
+        std::copy(from, from + size, values);
+    }
+}
+
+// End of ascending run that start from begin
+size_t Sort::NaturalRunEnd(const int32_t* values, size_t begin, size_t size) {
+    size_t end = std::min(begin + 1, size);
+    while (end < size && values[end] >= values[end - 1]) {
+        end++;
+    }
+
+    return end;
+}
+
+// Key of replacement selection heap, sign bit of value is flipped, so keys are ordered as values
+int64_t Sort::HeapKey(int64_t run, int32_t value) {
+    return (run << 32) | (int64_t) ((uint32_t) value ^ 0x80000000u);
+}
+
+int32_t Sort::HeapValue(int64_t key) {
+    return (int32_t) ((uint32_t) key ^ 0x80000000u);
+}
+
 // Second step of sorting
 // After first step we have folder /tmp/0/ witch store (N/M+1) files that contain sorted sequences
-// We can get two sorted files, merge it and save new sorted file at folder /tmp/1/
-// If 1 file have no pair, it just copy to folder for next round
-// Repeat it while until 1 file remains
-// btw it's just adaptation of merge sort
+// We can get K sorted files, merge it by loser tree and save new sorted file at folder /tmp/1/
+// If 1 file have no group, it just moved to folder for next round
+// Repeat it while until K or less files remain, they are merged straight to output tape,
+// next round write files of folder /tmp/0/ again
+// K is taken from memory limit, so all runs are merged in log_K(N/M) rounds
+// Groups of one round are independent, so they are merged concurrently by pool with thread for every drive,
+// next round start when all merges of round are finished
 void Sort::MergeTempFiles() {
+    int64_t k = GetMergeFanIn();
+    ThreadPool* pool = nullptr;
+    if (this->plan.GetMergeThreads() > 1) {
+        pool = new ThreadPool((int32_t) this->plan.GetMergeThreads());
+    }
+
     // i - number of round
     for (int64_t i = 0; true; i++) {
-        // If current temp folder have 1 file this is the end of sorting
-        if (this->IsLastMerged(i)) {
+        int64_t count = CountTmpFiles(i);
+
+        // Only one run can be written by replacement selection, file of run become output file if it has
+        // format of output tape, otherwise it's copied to output tape
+        if (count == 1 && MoveResultToOutputFile(i)) {
+            this->stats->BeginPhase("final_move");
+            this->stats->EndPhase(1);
+            break;
+        }
+        if (count == 1) {
+            this->stats->BeginPhase("final_copy");
             CopyResultToOutputTape(i);
+            this->stats->EndPhase(1);
+            break;
+        }
+
+        // The last round merge all files straight to output tape
+        if (count <= k) {
+            Clock::Global().Join();
+            this->stats->BeginPhase("merge_round");
+            MergeToOutputTape(i);
+            Clock::Global().Join();
+            this->stats->EndPhase(1);
+            this->stats->AddMergePass();
             break;
         }
 
+        std::filesystem::create_directories(GetTmpFolder(i+1));
+
         // Get iterator for work with files
         auto dir_iter = Sort::GetTmpDirectoryIterator(i);
+        // Merges of round start at the same virtual time, next round start when the longest merge is finished
+        Clock::Global().Join();
+        this->stats->BeginPhase("merge_round");
 
         int32_t counter = 0;
         // Going through all files in folder
         while(*dir_iter != end(*dir_iter)) {
-            // Try to get two files and merge it
-            auto f1 = **dir_iter;
-            (*dir_iter)++;
-            if (*dir_iter != end(*dir_iter)) {
-                auto f2 = **dir_iter;
+            // Try to get K files and merge it
+            std::vector<std::filesystem::directory_entry> files;
+            while (*dir_iter != end(*dir_iter) && (int64_t) files.size() < k) {
+                files.push_back(**dir_iter);
                 (*dir_iter)++;
+            }
 
-                // Open tapes for merge
-                auto tmp1 = OpenTempTape(f1);
-                auto tmp2 = OpenTempTape(f2);
-
-                // Create merged tape
-                auto merged = CreateTempTape(i+1, counter);
-
-                MergeFiles(merged, tmp1, tmp2);
-
-                delete tmp1;
-                delete tmp2;
-                delete merged;
-
-                counter++;
+            if (files.size() > 1 && pool != nullptr) {
+                pool->Submit([this, i, files, counter] { MergeGroup(i, files, counter); });
+            } else if (files.size() > 1) {
+                MergeGroup(i, files, counter);
             } else {
-                // If there was only 1 file, copy it to folder for next round
-                CopyOddTmpFile(i, f1);
+                // If there was only 1 file, move it to folder for next round
+                MoveOddTmpFile(i, files[0], counter);
             }
+            counter++;
         }
 
         delete dir_iter;
+
+        if (pool != nullptr) {
+            pool->Wait();
+        }
+        Clock::Global().Join();
+
+        RemoveStaleTmpFiles(i+1, counter);
+        this->stats->EndPhase(counter);
+        this->stats->AddMergePass();
     }
+
+    delete pool;
 }
 
-// Check count of files in folder
-bool Sort::IsLastMerged(int64_t i) const {
+// Merge group of files of round i to file with number in folder of the next round
+void Sort::MergeGroup(int64_t i, std::vector<std::filesystem::directory_entry> files, int64_t number) const {
+    // Open tapes for merge
+    std::vector<ITape*> tapes;
+    for (auto& file: files) {
+        tapes.push_back(OpenTempTape(file));
+    }
+
+    // Create merged tape
+    auto merged = CreateTempTape(i+1, number);
+
+    MergeFiles(merged, tapes);
+
+    for (auto tape: tapes) {
+        delete tape;
+    }
+    delete merged;
+}
+
+// Merge all files of round i to output tape
+void Sort::MergeToOutputTape(int64_t i) const {
     auto dir_iter = Sort::GetTmpDirectoryIterator(i);
+    std::vector<ITape*> tapes;
+    for (auto file: *dir_iter) {
+        tapes.push_back(OpenTempTape(file));
+    }
+    delete dir_iter;
+
+    auto out = CreateOutputTape();
+
+    MergeFiles(out, tapes);
 
-    int fileCount = std::count_if(
+    for (auto tape: tapes) {
+        delete tape;
+    }
+    delete out;
+}
+
+// Count of files that merged at once, it is taken from memory plan
+int64_t Sort::GetMergeFanIn() const {
+    return this->plan.GetFanIn();
+}
+
+// Count files in folder of round i
+int64_t Sort::CountTmpFiles(int64_t i) const {
+    auto dir_iter = Sort::GetTmpDirectoryIterator(i);
+
+    int64_t fileCount = std::count_if(
             begin(*dir_iter),
             end(*dir_iter),
             [](auto& entry) { return entry.is_regular_file(); }
@@ -145,11 +1014,7 @@ bool Sort::IsLastMerged(int64_t i) const {
 
     delete dir_iter;
 
-    if (fileCount == 1) {
-        return true;
-    }
-
-    return false;
+    return fileCount;
 }
 
 // Copy result tape to output tape
@@ -158,27 +1023,406 @@ void Sort::CopyResultToOutputTape(int64_t last_tmp_folder) const{
     auto merged = **dir_iter;
     auto merged_tape = OpenTempTape(merged);
 
+    CopyTapeToOutputTape(merged_tape);
+
+    delete dir_iter;
+    delete merged_tape;
+}
+
+// Rename the only file of round to output file, binary and mmap tapes keep cells in the same way
+// Return false if formats differ or file can't be renamed, for example if output is on other file system
+// Round should have only one file, moved numbers are counted as writes of output tape
+bool Sort::MoveResultToOutputFile(int64_t last_tmp_folder) const {
+    TapeFormat format = this->tape_settings.GetFormat();
+    bool binary = format == TapeFormat::Binary || format == TapeFormat::Mmap;
+    bool same = this->settings.GetOutputFormat() == TapeFormat::Binary ? binary : format == TapeFormat::Text;
+    if (!same) {
+        return false;
+    }
+
+    assert(CountTmpFiles(last_tmp_folder) == 1);
+    auto dir_iter = Sort::GetTmpDirectoryIterator(last_tmp_folder);
+    auto path = (**dir_iter).path();
+    delete dir_iter;
+
+    std::error_code error;
+    std::filesystem::rename(path, this->GetOutFileName(), error);
+    if (error) {
+        return false;
+    }
+
+    // No output tape is opened, but all numbers are on output tape as if they were copied
+    // Bytes aren't counted, file isn't written by rename
+    TapeStats moved;
+    moved.writes = this->stats->GetN();
+    moved.shifts_left = this->stats->GetN();
+    moved.syscalls = 1;
+    this->stats->GetOutputAccount()->Add(moved);
+
+    return true;
+}
+
+// Copy all numbers of result tape to output tape
+// Numbers are copied by bulk reads and writes through buffer of merge, if plan has no buffer they go one by one
+void Sort::CopyTapeToOutputTape(ITape *result_tape) const {
     auto out = CreateOutputTape();
 
-    merged_tape->Rewind();
+    result_tape->Rewind();
 
-    while(merged_tape->GetPosition() < merged_tape->GetN()) {
-        int32_t n = merged_tape->Read();
-        merged_tape->ShiftLeft();
+    int32_t cell;
+    int32_t* buffer = &cell;
+    int64_t size = 1;
+    BudgetVector<int32_t> block(BudgetAllocator<int32_t>(this->account));
+    if (this->plan.GetMergeBuffer() > 0) {
+        block.resize(this->plan.GetMergeBuffer());
+        buffer = block.data();
+        size = (int64_t) block.size();
+    }
 
-        out->Write(n);
-        out->ShiftLeft();
+    while (result_tape->GetPosition() < result_tape->GetN()) {
+        int64_t count = result_tape->ReadBlock(buffer, size);
+        out->WriteBlock(buffer, count);
     }
 
-    delete dir_iter;
-    delete merged_tape;
+    delete out;
+}
+
+// Sort with polyphase merge
+// Runs are distributed on TEMP_TAPES-1 tapes of folder /tmp/0/ while they are generated,
+// then they are merged by polyphase merge, the last merge write result to output tape
+// Backward merge get count of runs before distribution, so it can choose direction of every run
+void Sort::PolyphaseSort() {
+    std::vector<ITape*> tapes;
+    for (int32_t i = 0; i < this->settings.GetTempTapes(); i++) {
+        tapes.push_back(CreateTempTape(0, i));
+    }
+    RemoveStaleTmpFiles(0, this->settings.GetTempTapes());
+
+    bool backward = this->settings.GetMergeMode() == MergeMode::Backward;
+    this->polyphase = new PolyphaseMerge(tapes, this->account, this->plan.GetMergeBuffer(), backward);
+    if (backward) {
+        this->polyphase->Expect(CountRuns());
+    }
+
+    this->stats->BeginPhase("run_generation");
+    SortToTempFiles();
+    this->stats->EndPhase(this->runs);
+
+    // The last merge write straight to output tape
+    this->polyphase->SetStats(this->stats);
+    auto out = CreateOutputTape();
+    this->polyphase->Merge(out);
+    delete out;
+
+    delete this->polyphase;
+    this->polyphase = nullptr;
+}
+
+// Distribution sort
+// 1. Sample of input choose splitters of buckets
+// 2. Numbers are scattered to bucket tapes by one pass, numbers equal to splitter are only counted
+// 3. Buckets are sorted in order and written to output tape one after another,
+//    bucket that doesn't fit run buffer is distributed again
+// Bucket tapes take blocks and buffers as merged tapes do, memory plan give count of buckets at once
+// On uniform input it read input twice and temp tapes once if N/M buckets fit, merge need log_K(N/M) passes
+// Buckets are sorted one by one: they are appended to one output tape in order and memory plan has one run buffer
+// for them, so threads could only sort buckets in memory at once with run buffer for every thread
+void Sort::DistributionSort() {
+    auto out = CreateOutputTape();
+    DistributeTape(this->tape, out, true);
+    delete out;
+}
+
+// Sort numbers from the head of input to its end and append them to output tape
+// Bucket tape is deleted after it's scattered, so only the current bucket of every level stay opened
+void Sort::DistributeTape(ITape *input, ITape *out, bool top) {
+    int64_t start = input->GetPosition();
+    int64_t n = input->GetN() - start;
+    // All buckets are used, smaller buckets are less likely to overflow run buffer because of sample error
+    int64_t buckets = this->plan.GetBuckets();
+
+    if (top) {
+        this->stats->BeginPhase("sampling");
+    }
+    auto samples = SampleTape(input, n, buckets);
+    // Samples take at most half of run buffer, so head is moved by buffer of the other half
+    MoveHead(input, start, std::max<int64_t>(1, this->plan.GetRunBuffer() / 2));
+
+    // Repeated splitters are dropped, so every bucket is less than input
+    // Splitters and counters of buckets are small to compare with blocks of bucket tapes, so they aren't counted
+    std::vector<int32_t> splitters;
+    for (int64_t j = 1; j < buckets; j++) {
+        int32_t splitter = (*samples)[j * samples->size() / buckets];
+        if (splitters.empty() || splitter != splitters.back()) {
+            splitters.push_back(splitter);
+        }
+    }
+    delete samples;
+
+    if (top) {
+        this->stats->EndPhase(0);
+        this->stats->BeginPhase("distribution");
+    }
+    std::vector<int64_t> numbers;
+    std::vector<int64_t> sizes;
+    std::vector<int64_t> equal;
+    ScatterTape(input, n, splitters, numbers, sizes, equal);
+    if (!top) {
+        delete input;
+    }
+
+    if (top) {
+        this->stats->EndPhase((int64_t) numbers.size());
+        this->stats->BeginPhase("bucket_sort");
+    }
+    for (size_t j = 0; j < numbers.size(); j++) {
+        if (sizes[j] > 0) {
+            SortBucket(numbers[j], out);
+        }
+        std::filesystem::remove(GetTempPath(0, numbers[j]));
+
+        if (j < splitters.size()) {
+            WriteCopies(out, splitters[j], equal[j]);
+        }
+    }
+    if (top) {
+        this->stats->EndPhase(1);
+    }
+}
+
+// Read n numbers from the head of input and take every n/count-th number to sorted sample
+BudgetVector<int32_t>* Sort::SampleTape(ITape *input, int64_t n, int64_t buckets) const {
+    int64_t half = std::max<int64_t>(1, this->plan.GetRunBuffer() / 2);
+    int64_t count = std::min(buckets * DISTRIBUTION_OVERSAMPLING, half);
+    int64_t stride = std::max<int64_t>(1, n / count);
+
+    auto samples = new BudgetVector<int32_t>(BudgetAllocator<int32_t>(this->account));
+    samples->reserve(count);
+    BudgetVector<int32_t> chunk(std::min<int64_t>(half, this->plan.GetBlockSize()), 0,
+                                BudgetAllocator<int32_t>(this->account));
+    for (int64_t i = 0; i < n;) {
+        int64_t read = input->ReadBlock(chunk.data(), std::min((int64_t) chunk.size(), n - i));
+        if (read == 0) {
+            break;
+        }
+        for (int64_t k = (stride - i % stride) % stride; k < read && (int64_t) samples->size() < count; k += stride) {
+            samples->push_back(chunk[k]);
+        }
+        i += read;
+    }
+    std::sort(samples->begin(), samples->end());
+
+    return samples;
+}
+
+// Scatter n numbers from the head of input to new bucket tapes, bucket j get numbers between splitters j-1 and j
+// Numbers equal to splitter j are counted in equal[j], they are written to output tape after bucket j
+void Sort::ScatterTape(ITape *input, int64_t n, const std::vector<int32_t>& splitters,
+                       std::vector<int64_t>& numbers, std::vector<int64_t>& sizes, std::vector<int64_t>& equal) {
+    std::vector<ITape*> tapes;
+    std::vector<BlockWriter*> writers;
+    for (size_t j = 0; j <= splitters.size(); j++) {
+        numbers.push_back(this->runs++);
+        tapes.push_back(CreateTempTape(0, numbers.back()));
+        writers.push_back(new BlockWriter(tapes.back(), this->plan.GetMergeBuffer(), this->account));
+    }
+    sizes.assign(numbers.size(), 0);
+    equal.assign(splitters.size(), 0);
+
+    BudgetVector<int32_t> buffer(std::max<int64_t>(1, this->plan.GetMergeBuffer()), 0,
+                                 BudgetAllocator<int32_t>(this->account));
+    for (int64_t i = 0; i < n;) {
+        int64_t read = input->ReadBlock(buffer.data(), std::min((int64_t) buffer.size(), n - i));
+        if (read == 0) {
+            break;
+        }
+        for (int64_t k = 0; k < read; k++) {
+            auto j = std::lower_bound(splitters.begin(), splitters.end(), buffer[k]) - splitters.begin();
+            if (j < (int64_t) splitters.size() && splitters[j] == buffer[k]) {
+                equal[j]++;
+            } else {
+                writers[j]->Write(buffer[k]);
+                sizes[j]++;
+            }
+        }
+        i += read;
+    }
+
+    for (size_t j = 0; j < tapes.size(); j++) {
+        delete writers[j];
+        delete tapes[j];
+    }
+}
+
+// Sort bucket in memory if it fit run buffer, otherwise distribute it again
+void Sort::SortBucket(int64_t number, ITape *out) {
+    auto bucket = CreateTape(GetTempPath(0, number));
+    if (bucket->GetN() > this->plan.GetRunBuffer()) {
+        DistributeTape(bucket, out, false);
+        return;
+    }
+
+    auto values = new BudgetVector<int32_t>(BudgetAllocator<int32_t>(this->account));
+    values->resize(bucket->GetN());
+    bucket->ReadBlock(values->data(), (int64_t) values->size());
+    delete bucket;
+
+    auto scratch = this->plan.GetRadixSort() ? CreateScratch() : nullptr;
+    SortRun(values, scratch);
+    delete scratch;
+
+    WriteVectorToTape(out, values);
+    delete values;
+}
+
+// Append count copies of value to output tape by bulk writes through buffer of block size
+void Sort::WriteCopies(ITape *out, int32_t value, int64_t count) const {
+    if (count <= 0) {
+        return;
+    }
+
+    BudgetVector<int32_t> buffer(std::min<int64_t>(count, this->plan.GetBlockSize()), value,
+                                 BudgetAllocator<int32_t>(this->account));
+    for (int64_t left = count; left > 0; left -= (int64_t) buffer.size()) {
+        out->WriteBlock(buffer.data(), std::min(left, (int64_t) buffer.size()));
+    }
+}
+
+// Move head of tape to position after pass over tape by bulk reads through buffer of buffer_size numbers
+// Tape is rewound if position is closer to the start than to the head, otherwise head go back by backward reads
+void Sort::MoveHead(ITape *tape, int64_t position, int64_t buffer_size) const {
+    if (tape->GetPosition() - position > position) {
+        tape->Rewind();
+    }
+    int64_t distance = std::abs(tape->GetPosition() - position);
+    if (distance == 0) {
+        return;
+    }
+
+    BudgetVector<int32_t> buffer(std::clamp<int64_t>(buffer_size, 1, distance), 0,
+                                 BudgetAllocator<int32_t>(this->account));
+    while (tape->GetPosition() > position) {
+        tape->ReadBlockBackward(buffer.data(), std::min((int64_t) buffer.size(), tape->GetPosition() - position));
+    }
+    while (tape->GetPosition() < position) {
+        if (tape->ReadBlock(buffer.data(), std::min((int64_t) buffer.size(), position - tape->GetPosition())) == 0) {
+            break;
+        }
+    }
+}
+
+// Partial sort write only k least numbers of input to output tape in sorted order
+// Max-heap keep the least numbers that were read, so k numbers that fit heap are selected by one pass over input
+// Bigger k is selected by several passes, every pass select next numbers after the last written one
+// If it need more passes than full sort would take, whole input is sorted and output tape is cut after k numbers
+void Sort::StartPartial(int64_t k) {
+    if (!this->plan.Fits()) {
+        throw std::invalid_argument(this->plan.Report());
+    }
+
+    int64_t start = this->tape->GetPosition();
+    int64_t n = this->tape->GetN() - start;
+    int64_t heap = this->plan.GetSelectionHeap();
+    k = std::max<int64_t>(0, k);
+    if (k >= n || (k + heap - 1) / heap > GetSelectionMaxPasses(n)) {
+        Start();
+        if (k < n) {
+            CutOutputTape(k);
+        }
+        return;
+    }
+
+    this->stats->SetN(n);
+
+    auto out = CreateOutputTape();
+    int32_t last = INT32_MIN;
+    int64_t last_count = 0;
+    for (int64_t written = 0; written < k; written += heap) {
+        this->stats->BeginPhase("selection");
+        if (written > 0) {
+            MoveHead(this->tape, start, this->plan.GetBlockSize());
+        }
+        SelectToOutputTape(out, std::min(heap, k - written), written > 0, last, last_count);
+        this->runs++;
+        this->stats->EndPhase(1);
+    }
+    delete out;
+
+    this->stats->SetRuns(this->runs);
+    this->stats->SetInputStats(this->tape->GetStats());
+}
+
+// Select count least numbers from the head of input to the end and append them to output tape
+// If after is set, only numbers after the last written one are selected: numbers greater than last and copies of last
+// after last_count of them that were already written, last and last_count are updated for the next pass
+void Sort::SelectToOutputTape(ITape *out, int64_t count, bool after, int32_t &last, int64_t &last_count) {
+    auto heap = new BudgetVector<int32_t>(BudgetAllocator<int32_t>(this->account));
+    heap->reserve(count);
+    auto buffer = new BudgetVector<int32_t>(this->plan.GetBlockSize(), 0, BudgetAllocator<int32_t>(this->account));
+
+    int64_t skipped = 0;
+    while (true) {
+        int64_t read = this->tape->ReadBlock(buffer->data(), (int64_t) buffer->size());
+        if (read == 0) {
+            break;
+        }
+
+        for (int64_t i = 0; i < read; i++) {
+            int32_t value = (*buffer)[i];
+            if (after && (value < last || (value == last && skipped++ < last_count))) {
+                continue;
+            }
+
+            // The greatest of selected numbers is on the top of heap and it is replaced by less one
+            if ((int64_t) heap->size() < count) {
+                heap->push_back(value);
+                std::push_heap(heap->begin(), heap->end());
+            } else if (value < heap->front()) {
+                std::pop_heap(heap->begin(), heap->end());
+                heap->back() = value;
+                std::push_heap(heap->begin(), heap->end());
+            }
+        }
+    }
+    delete buffer;
+
+    std::sort_heap(heap->begin(), heap->end());
+    WriteVectorToTape(out, heap);
+
+    if (!heap->empty()) {
+        int32_t value = heap->back();
+        auto copies = (int64_t) (heap->end() - std::lower_bound(heap->begin(), heap->end(), value));
+        last_count = after && value == last ? last_count + copies : copies;
+        last = value;
+    }
+    delete heap;
+}
+
+// Count of passes over input that partial sort can take instead of full sort of n numbers
+// Pass of selection read every number once, full sort read and write every number once to generate runs
+// and once more for every merge pass, both write k numbers to output, so selection is cheaper while
+// passes <= 2 * (1 + merge passes), input that fit memory is read and written once without merge
+int64_t Sort::GetSelectionMaxPasses(int64_t n) const {
+    int64_t runs = (n + this->plan.GetRunBuffer() - 1) / this->plan.GetRunBuffer();
+    int64_t fan_in = std::max<int64_t>(2, this->plan.GetFanIn());
+    int64_t merges = 0;
+    for (; runs > 1; runs = (runs + fan_in - 1) / fan_in) {
+        merges++;
+    }
+
+    return 2 * (1 + merges);
+}
+
+// Cut output tape of full sort after k numbers
+void Sort::CutOutputTape(int64_t k) const {
+    auto out = OpenOutputTape();
+    MoveHead(out, k, this->plan.GetBlockSize());
+    out->Truncate();
     delete out;
 }
 
 // Open existing tape file
 ITape *Sort::OpenTempTape(std::filesystem::directory_entry& file) const {
-    TapeSettings settings(SETTINGS_PATH);
-
 #ifdef __MINGW64__
     // This work on MinGW
     auto wpath = std::wstring(file.path().c_str());
@@ -190,84 +1434,51 @@ ITape *Sort::OpenTempTape(std::filesystem::directory_entry& file) const {
 
     std::string path(wpath.begin(), wpath.end());
 
-    return (ITape*) new Tape(path, settings);
+    return this->CreateTape(path);
 }
 
 std::filesystem::directory_iterator* Sort::GetTmpDirectoryIterator(int64_t i) const {
-    auto dir = std::string(TMP_PATH);
-    dir += std::to_string(i);
+    auto dir = GetTmpFolder(i);
     auto dir_iter = new std::filesystem::directory_iterator(dir);
 
     return dir_iter;
 }
 
-void Sort::CopyOddTmpFile(int64_t i, std::filesystem::directory_entry& file) const {
-    std::string tmp(TMP_PATH);
-    tmp += std::to_string(i+1);
+// Move file without pair to folder of next round with number after merged files
+// File is renamed, so its numbers aren't read and written again
+void Sort::MoveOddTmpFile(int64_t i, std::filesystem::directory_entry& file, int64_t number) const {
+    std::string tmp = GetTmpFolder(i+1);
+    std::filesystem::create_directories(tmp);
     tmp += "/";
-    tmp += file.path().filename().string();
+    tmp += std::to_string(number);
+    tmp += GetTempExtension();
 
-    std::filesystem::copy(file, tmp);
+    std::filesystem::rename(file.path(), tmp);
 }
 
 // Merge files method
-// tape1 and tape2 are sorted
-// 1. Get first number from tape1 and tape2
-// 2. Add to merged tape lesser number, get next number from that tape witch has lesser number
-// If we reach end of one of tape we can just copy other tape to merged tape
-void Sort::MergeFiles(ITape *merged_tape, ITape *tape1, ITape *tape2) const {
-    // Get first numbers
-    int32_t n1 = tape1->Read();
-    int32_t n2 = tape2->Read();
-
-    while (true) {
-        // While numbers in tape1 lesser than first number of tape2 copy numbers from tape1 to merged tape
-        while (n1 <= n2 && tape1->GetPosition() < tape1->GetN()) {
-            merged_tape->Write(n1);
-            merged_tape->ShiftLeft();
-
-            tape1->ShiftLeft();
-            n1 = tape1->Read();
-        }
-        // If reach end of tape1 - copy tape2 to merged tape
-        if (tape1->GetPosition() == tape1->GetN()) {
-            while (tape2->GetPosition() < tape2->GetN()) {
-                merged_tape->Write(n2);
-                merged_tape->ShiftLeft();
-
-                tape2->ShiftLeft();
-                n2 = tape2->Read();
-            }
-            break;
-        }
-
-        // While numbers in tape2 lesser than first number of tape1 copy numbers from tape2 to merged tape
-        while (n2 <= n1 && tape2->GetPosition() < tape2->GetN()) {
-            merged_tape->Write(n2);
-            merged_tape->ShiftLeft();
+// All tapes are sorted
+// Loser tree give the least number of all tapes, it is written to merged tape and next number of that tape is read
+// Tapes are read and written by blocks of merge buffer from memory plan
+void Sort::MergeFiles(ITape *merged_tape, std::vector<ITape*>& tapes) const {
+    BlockWriter merged(merged_tape, this->plan.GetMergeBuffer(), this->account);
+    LoserTree tree(tapes, this->account, this->plan.GetMergeBuffer());
 
-            tape2->ShiftLeft();
-            n2 = tape2->Read();
-        }
-        // If reach end of tape2 - copy tape1 to merged tape
-        if (tape2->GetPosition() == tape2->GetN()) {
-            while (tape1->GetPosition() < tape1->GetN()) {
-                merged_tape->Write(n1);
-                merged_tape->ShiftLeft();
-
-                tape1->ShiftLeft();
-                n1 = tape1->Read();
-            }
-            break;
-        }
+    while (!tree.Empty()) {
+        merged.Write(tree.Top());
+        tree.Pop();
     }
+    merged.Flush();
 }
 
 std::string Sort::GetOutFileName() const {
     return this->output_file_name;
 }
 
-Sort::~Sort() = default;
+Sort::~Sort() {
+    delete this->stats;
+    delete this->account;
+}
 
 
 
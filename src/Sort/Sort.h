@@ -4,46 +4,278 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <atomic>
 
 #include "ISort.h"
+#include "PolyphaseMerge.h"
+#include "MemoryPlan.h"
+#include "SortStats.h"
 #include "../Tape/ITape.h"
+#include "../Tape/Tape.h"
+#include "../Memory/MemoryAccount.h"
+#include "../Memory/BudgetAllocator.h"
+#include "../Thread/BoundedQueue.h"
 
 #define TMP_PATH "../../src/tmp/"
+// Settings of sort and temp tapes, tests are built with own settings of virtual clock
+#ifndef SETTINGS_PATH
 #define SETTINGS_PATH "../../src/settings.txt"
+#endif
+// Count of temp folders that used by merge rounds in turn
+#define TMP_FOLDERS 2
+
+// Define strings of settings.txt file that used for sort settings
+#define RUN_GENERATION_STR "RUN_GENERATION"
+#define MERGE_MODE_STR "MERGE_MODE"
+#define TEMP_TAPES_STR "TEMP_TAPES"
+#define MEMORY_LIMIT_STR "MEMORY_LIMIT"
+#define SORT_THREADS_STR "SORT_THREADS"
+#define SORT_KERNEL_STR "SORT_KERNEL"
+#define DRIVES_STR "DRIVES"
+#define PREFETCH_STR "PREFETCH"
+#define STRATEGY_STR "STRATEGY"
+#define COUNTING_STR "COUNTING"
+
+// Define values of RUN_GENERATION setting
+#define RUN_GENERATION_CHUNK_STR "CHUNK"
+#define RUN_GENERATION_REPLACEMENT_STR "REPLACEMENT_SELECTION"
+#define RUN_GENERATION_NATURAL_STR "NATURAL"
+
+// Define values of MERGE_MODE setting
+#define MERGE_MODE_BALANCED_STR "BALANCED"
+#define MERGE_MODE_POLYPHASE_STR "POLYPHASE"
+#define MERGE_MODE_BACKWARD_STR "BACKWARD"
+
+// Define values of SORT_KERNEL setting
+#define SORT_KERNEL_STD_STR "STD"
+#define SORT_KERNEL_RADIX_STR "RADIX"
+
+// Define values of STRATEGY setting
+#define STRATEGY_MERGE_STR "MERGE"
+#define STRATEGY_DISTRIBUTION_STR "DISTRIBUTION"
+
+// Define values of PREFETCH setting
+#define PREFETCH_ON_STR "ON"
+#define PREFETCH_OFF_STR "OFF"
+
+// Define values of COUNTING setting
+#define COUNTING_ON_STR "ON"
+#define COUNTING_OFF_STR "OFF"
+
+// Count of temp tapes for polyphase merge if TEMP_TAPES not set, it can't be less than MIN_TEMP_TAPES
+#define DEFAULT_TEMP_TAPES 4
+#define MIN_TEMP_TAPES 3
+
+// Count of samples for every bucket of distribution sort
+#define DISTRIBUTION_OVERSAMPLING 16
+
+// Memory limit M in bytes if MEMORY_LIMIT not set
+#define DEFAULT_MEMORY_LIMIT (1 << 20)
+
+// Way to split input tape into sorted runs
+enum class RunGeneration {
+    // Read M numbers, sort them and write, every run has M numbers
+    Chunk,
+    // Keep heap of M numbers and write to run while numbers allow it, runs are about 2M long
+    ReplacementSelection,
+    // Find ascending and descending runs that already are in input and merge them in memory,
+    // run continue to the next chunk while its numbers keep order, sorted input is copied to output in one pass
+    Natural
+};
+
+// Way to merge runs
+enum class MergeMode {
+    // Every run is stored in own file, K files are merged to new file in every round
+    Balanced,
+    // Runs are stored on fixed count of temp tapes that are reused for the whole sort
+    Polyphase,
+    // Polyphase merge that read tapes backward, so tapes are never rewound
+    // Count of runs should be known before distribution, so chunk run generation is always used
+    Backward
+};
+
+// Way to sort numbers that don't fit memory
+enum class SortStrategy {
+    // Sorted runs are written to temp tapes and merged
+    Merge,
+    // Sample of input choose splitters, numbers are scattered to bucket tapes by them and every bucket is sorted
+    // in memory or distributed again, buckets are written to output tape one after another without merge
+    Distribution
+};
+
+// Way to sort chunk of numbers in chunk run generation
+enum class SortKernel {
+    // std::sort
+    Std,
+    // LSD radix sort, it need scratch buffer of chunk size, so chunks become shorter
+    Radix
+};
+
+// SortSettings define algorithms that used by sort
+class SortSettings {
+public:
+    // Constructors
+    SortSettings(const std::string& settingsFileName);
+    SortSettings();
+
+    // Getters
+    RunGeneration GetRunGeneration() const;
+    MergeMode GetMergeMode() const;
+    int32_t GetTempTapes() const;
+    int64_t GetMemoryLimit() const;
+    int32_t GetSortThreads() const;
+    SortKernel GetSortKernel() const;
+    int32_t GetDrives() const;
+    bool GetPrefetch() const;
+    TapeFormat GetOutputFormat() const;
+    SortStrategy GetStrategy() const;
+    bool GetCounting() const;
+
+    // Setters
+    void SetRunGeneration(RunGeneration run_generation);
+    void SetMergeMode(MergeMode merge_mode);
+    void SetTempTapes(int32_t temp_tapes);
+    void SetMemoryLimit(int64_t memory_limit);
+    void SetSortThreads(int32_t sort_threads);
+    void SetSortKernel(SortKernel sort_kernel);
+    void SetDrives(int32_t drives);
+    void SetPrefetch(bool prefetch);
+    void SetOutputFormat(TapeFormat output_format);
+    void SetStrategy(SortStrategy strategy);
+    void SetCounting(bool counting);
+
+    // Destructor
+    ~SortSettings();
+private:
+    RunGeneration run_generation;
+    MergeMode merge_mode;
+    int32_t temp_tapes;
+    int64_t memory_limit;
+    // Count of threads that sort chunks in pipeline of run generation, 0 - run generation without pipeline
+    int32_t sort_threads;
+    SortKernel sort_kernel;
+    // Count of drives that can move tapes at the same time, merges of one round run on them concurrently
+    int32_t drives;
+    // Temp and output tapes are wrapped by PrefetchingTape
+    bool prefetch;
+    // Format of output file, binary output is exported to text by caller, it isn't read from settings.txt
+    TapeFormat output_format;
+    SortStrategy strategy;
+    // Input is counted to histogram before sort, if it has few distinct numbers output is written from histogram
+    bool counting;
+};
+
+// Chunk of input tape in pipeline of run generation, number keep order of runs
+struct RunChunk {
+    int64_t number;
+    BudgetVector<int32_t>* values;
+};
 
 // Sort implement interface ISort
 class Sort: public ISort {
 public:
-    // Constructor
+    // Constructors, M is memory limit in bytes
     Sort(ITape* tape, const std::string& out_file_name, int64_t M);
+    Sort(ITape* tape, const std::string& out_file_name, int64_t M, const SortSettings& settings);
 
     // Override start method
     void Start() override;
+    void StartPartial(int64_t k) override;
+
+    // Memory usage
+    const MemoryPlan& GetMemoryPlan() const;
+    int64_t GetPeakMemory() const;
+
+    // Phases of sort and counters of its tapes, they are complete when Start is finished
+    const SortStats& GetStats() const;
 
     ~Sort() override;
 
 private:
     std::string output_file_name;
+    SortSettings settings;
+    // Settings of temp and output tapes, file is read once, so all tapes of sort have the same format
+    TapeSettings tape_settings;
+
+    // Count of written runs
+    int64_t runs;
+    // Polyphase merge that get runs, nullptr for balanced merge
+    PolyphaseMerge* polyphase;
+
+    // Split of memory limit and account that count memory of sort
+    MemoryPlan plan;
+    MemoryAccount* account;
+    // Stats of sort, temp and output tapes add their counters to its accounts
+    SortStats* stats;
 
     // Getter
     std::string GetOutFileName() const;
 
     // First step of sorting
     void SortToTempFiles();
-    std::vector<int32_t>* ReadMValues() const;
+    void SortToOutputTape();
+    void ReplacementSelectionToTempFiles();
+    void PipelineToTempFiles();
+    void ReadChunks(BoundedQueue<BudgetVector<int32_t>*>& free_buffers, BoundedQueue<RunChunk>& read) const;
+    static void SortChunks(BoundedQueue<RunChunk>& read, BoundedQueue<RunChunk>& sorted,
+                           std::atomic<int32_t>& sorters, BudgetVector<int32_t>* scratch);
+    static void SortRun(BudgetVector<int32_t>* values, BudgetVector<int32_t>* scratch);
+    BudgetVector<int32_t>* CreateScratch() const;
+    static int64_t HeapKey(int64_t run, int32_t value);
+    static int32_t HeapValue(int64_t key);
+    bool CopySortedInput();
+    bool CountToOutputTape();
+    void NaturalRunsToTempFiles();
+    static void MergeNaturalRuns(int32_t* values, int32_t* scratch, size_t size);
+    static size_t NaturalRunEnd(const int32_t* values, size_t begin, size_t size);
+    ITape* BeginRun();
+    void EndRun(ITape* run_tape, int64_t length);
+    void WriteRun(BudgetVector<int32_t>* values);
+    int64_t CountRuns() const;
+    BudgetVector<int32_t>* ReadMValues() const;
+    void ReadValues(BudgetVector<int32_t>* values) const;
     ITape* CreateTempTape(int64_t temp_folder, int64_t number) const;
+    std::string GetTmpFolder(int64_t i) const;
+    void RemoveStaleTmpFiles(int64_t i, int64_t count) const;
     ITape* CreateOutputTape() const;
-    ITape* CreateTape(std::string file_path, std::string setting) const;
-    void WriteVectorToTape(ITape* tape, std::vector<int32_t>* vector) const;
+    ITape* OpenOutputTape() const;
+    ITape* CreateTape(std::string file_path) const;
+    ITape* Prefetch(ITape* tape) const;
+    std::string GetTempExtension() const;
+    void WriteVectorToTape(ITape* tape, BudgetVector<int32_t>* vector) const;
 
     // Second step of sorting
     void MergeTempFiles();
+    void MergeGroup(int64_t i, std::vector<std::filesystem::directory_entry> files, int64_t number) const;
     ITape* OpenTempTape(std::filesystem::directory_entry& file) const;
-    void MergeFiles(ITape* merge_tape, ITape* tape1, ITape* tape2) const;
-    bool IsLastMerged(int64_t i) const;
+    int64_t GetMergeFanIn() const;
+    void MergeFiles(ITape* merge_tape, std::vector<ITape*>& tapes) const;
+    void MergeToOutputTape(int64_t i) const;
+    int64_t CountTmpFiles(int64_t i) const;
     std::filesystem::directory_iterator* GetTmpDirectoryIterator(int64_t i) const;
-    void CopyOddTmpFile(int64_t i, std::filesystem::directory_entry& file) const;
+    void MoveOddTmpFile(int64_t i, std::filesystem::directory_entry& file, int64_t number) const;
     void CopyResultToOutputTape(int64_t last_tmp_folder) const;
+    bool MoveResultToOutputFile(int64_t last_tmp_folder) const;
+    void CopyTapeToOutputTape(ITape* result_tape) const;
+
+    // Polyphase merge
+    void PolyphaseSort();
+
+    // Distribution sort
+    void DistributionSort();
+    void DistributeTape(ITape* input, ITape* out, bool top);
+    BudgetVector<int32_t>* SampleTape(ITape* input, int64_t n, int64_t buckets) const;
+    void ScatterTape(ITape* input, int64_t n, const std::vector<int32_t>& splitters,
+                     std::vector<int64_t>& numbers, std::vector<int64_t>& sizes, std::vector<int64_t>& equal);
+    void SortBucket(int64_t number, ITape* out);
+    std::string GetTempPath(int64_t temp_folder, int64_t number) const;
+    void WriteCopies(ITape* out, int32_t value, int64_t count) const;
+    void MoveHead(ITape* tape, int64_t position, int64_t buffer_size) const;
+
+    // Partial sort
+    void SelectToOutputTape(ITape* out, int64_t count, bool after, int32_t& last, int64_t& last_count);
+    void CutOutputTape(int64_t k) const;
+    int64_t GetSelectionMaxPasses(int64_t n) const;
 
 };
 
@@ -0,0 +1,136 @@
+#include "SortStats.h"
+#include "../Tape/Clock.h"
+
+#include <sstream>
+
+SortStats::SortStats() {
+    this->phase_tape_start = 0;
+    this->n = 0;
+    this->runs = 0;
+    this->merge_passes = 0;
+}
+
+// Tape time is taken from clock, so phase should start and end when other threads of sort are joined
+void SortStats::BeginPhase(const std::string& name) {
+    this->phases.push_back(PhaseStats{name, 0, 0, 0});
+    this->phase_start = std::chrono::steady_clock::now();
+    this->phase_tape_start = Clock::Global().GetElapsed().count();
+}
+
+void SortStats::EndPhase(int64_t runs) {
+    auto& phase = this->phases.back();
+    phase.time = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - this->phase_start).count();
+    phase.tape_time = Clock::Global().GetElapsed().count() - this->phase_tape_start;
+    phase.runs = runs;
+}
+
+void SortStats::AddMergePass() {
+    this->merge_passes++;
+}
+
+void SortStats::SetN(int64_t n) {
+    this->n = n;
+}
+
+void SortStats::SetRuns(int64_t runs) {
+    this->runs = runs;
+}
+
+void SortStats::SetInputStats(const TapeStats& stats) {
+    this->input = stats;
+}
+
+const std::vector<PhaseStats>& SortStats::GetPhases() const {
+    return this->phases;
+}
+
+int64_t SortStats::GetN() const {
+    return this->n;
+}
+
+int64_t SortStats::GetRuns() const {
+    return this->runs;
+}
+
+int64_t SortStats::GetMergePasses() const {
+    return this->merge_passes;
+}
+
+double SortStats::GetDataPasses() const {
+    if (this->n == 0) {
+        return 0;
+    }
+
+    return (double) GetTempStats().reads / (double) this->n;
+}
+
+TapeStats SortStats::GetInputStats() const {
+    return this->input;
+}
+
+TapeStats SortStats::GetTempStats() const {
+    return this->temp.GetTotal();
+}
+
+TapeStats SortStats::GetOutputStats() const {
+    return this->output.GetTotal();
+}
+
+StatsAccount* SortStats::GetTempAccount() {
+    return &this->temp;
+}
+
+StatsAccount* SortStats::GetOutputAccount() {
+    return &this->output;
+}
+
+std::string SortStats::ToJson() const {
+    std::stringstream json;
+
+    json << "{\"n\": " << this->n
+         << ", \"runs\": " << this->runs
+         << ", \"merge_passes\": " << this->merge_passes
+         << ", \"data_passes\": " << GetDataPasses()
+         << ", \"phases\": [";
+    for (size_t i = 0; i < this->phases.size(); i++) {
+        auto& phase = this->phases[i];
+        json << (i > 0 ? ", " : "")
+             << "{\"name\": \"" << phase.name << "\""
+             << ", \"time_us\": " << phase.time
+             << ", \"tape_time_us\": " << phase.tape_time
+             << ", \"runs\": " << phase.runs << "}";
+    }
+    json << "], \"tapes\": {"
+         << "\"input\": " << this->input.ToJson()
+         << ", \"temp\": " << GetTempStats().ToJson()
+         << ", \"output\": " << GetOutputStats().ToJson()
+         << ", \"temp_count\": " << this->temp.GetTapes() << "}}";
+
+    return json.str();
+}
+
+std::string SortStats::Report() const {
+    std::stringstream report;
+
+    report << "Runs: " << this->runs << ", merge passes: " << this->merge_passes
+           << ", numbers read from temp tapes: " << GetDataPasses() << " x N" << std::endl;
+    for (auto& phase: this->phases) {
+        report << "Phase " << phase.name << ": " << phase.time / 1000 << " ms, tape time "
+               << phase.tape_time / 1000 << " ms, " << phase.runs << " runs" << std::endl;
+    }
+
+    std::vector<std::pair<std::string, TapeStats>> tapes = {
+            {"Input", this->input}, {"Temp", GetTempStats()}, {"Output", GetOutputStats()}};
+    for (auto& [name, stats]: tapes) {
+        report << name << " tapes: " << stats.reads << " reads, " << stats.writes << " writes, "
+               << stats.shifts_left << "/" << stats.shifts_right << " shifts left/right, "
+               << stats.rewinds << " rewinds, " << stats.bytes_read << "/" << stats.bytes_written
+               << " bytes read/written, " << stats.syscalls << " syscalls, "
+               << stats.delay / 1000 << " ms delay" << std::endl;
+    }
+
+    return report.str();
+}
+
+SortStats::~SortStats() = default;
@@ -0,0 +1,78 @@
+#ifndef TEST_SORTSTATS_H
+#define TEST_SORTSTATS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "../Tape/TapeStats.h"
+
+// Time of one phase of sort
+struct PhaseStats {
+    // direct_sort, sorted_copy, run_generation, merge_round, merge_phase or final_copy
+    std::string name;
+    // Wall time in microseconds
+    int64_t time;
+    // Time that tapes spent in microseconds, it's time of clock
+    int64_t tape_time;
+    // Count of runs after phase
+    int64_t runs;
+};
+
+// SortStats collect phases of sort and counters of its tapes
+// Temp and output tapes add their counters to accounts of stats when they are deleted
+class SortStats {
+public:
+    SortStats();
+
+    // Copying prohibited
+    SortStats(const SortStats&) = delete;
+    SortStats& operator=(const SortStats&) = delete;
+
+    // Phase is measured from BeginPhase to EndPhase, phases can't be nested
+    void BeginPhase(const std::string& name);
+    void EndPhase(int64_t runs);
+    // Merge round of balanced merge or phase of polyphase merge
+    void AddMergePass();
+
+    // Setters
+    void SetN(int64_t n);
+    void SetRuns(int64_t runs);
+    void SetInputStats(const TapeStats& stats);
+
+    // Getters
+    const std::vector<PhaseStats>& GetPhases() const;
+    int64_t GetN() const;
+    int64_t GetRuns() const;
+    int64_t GetMergePasses() const;
+    // How many times every number was read from temp tapes
+    double GetDataPasses() const;
+    TapeStats GetInputStats() const;
+    TapeStats GetTempStats() const;
+    TapeStats GetOutputStats() const;
+    StatsAccount* GetTempAccount();
+    StatsAccount* GetOutputAccount();
+
+    // Stats as JSON object or as text for console
+    std::string ToJson() const;
+    std::string Report() const;
+
+    ~SortStats();
+private:
+    std::vector<PhaseStats> phases;
+    std::chrono::steady_clock::time_point phase_start;
+    int64_t phase_tape_start;
+
+    int64_t n;
+    // Count of initial runs
+    int64_t runs;
+    int64_t merge_passes;
+
+    TapeStats input;
+    StatsAccount temp;
+    StatsAccount output;
+};
+
+
+#endif //TEST_SORTSTATS_H
@@ -0,0 +1,112 @@
+#include "BinaryTape.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+
+// BinaryTape constructor
+// Block is the only buffer of tape, so every block is read or written by one call to file
+BinaryTape::BinaryTape(const std::string& inputFileName, TapeSettings& settings)
+        : BlockTape(inputFileName, settings, true) {
+    // Calculate N
+    this->N = CalculateN(inputFileName);
+    this->stats.syscalls++;
+}
+
+int64_t BinaryTape::CalculateN(const std::string& inputFileName) const {
+    // All cells have same size, so there is no need to read file
+    std::error_code error;
+    auto size = std::filesystem::file_size(inputFileName, error);
+    if (error) {
+        return 0;
+    }
+
+    return (int64_t) size / CELL_SIZE;
+}
+
+void BinaryTape::EncodeCell(int32_t n, char* bytes) {
+    auto value = (uint32_t) n;
+    for (int i = 0; i < CELL_SIZE; i++) {
+        bytes[i] = (char) ((value >> (8 * i)) & 0xFF);
+    }
+}
+
+int32_t BinaryTape::DecodeCell(const char* bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < CELL_SIZE; i++) {
+        value |= ((uint32_t) (unsigned char) bytes[i]) << (8 * i);
+    }
+    return (int32_t) value;
+}
+
+// Load block with index to memory, current block is flushed before
+void BinaryTape::LoadBlock(int64_t index) {
+    if (index == this->block_index) {
+        return;
+    }
+
+    FlushBlock();
+
+    int64_t size = this->settings.GetBlockSize();
+    int64_t first = index * size;
+    int64_t count = std::min(size, this->GetN() - first);
+
+    // Read all cells of the block by one call and decode them in place
+    this->block.clear();
+    this->block.reserve(size);
+    this->block.resize(count);
+    this->stream.seekg(first * CELL_SIZE);
+    this->stream.read((char*) this->block.data(), count * CELL_SIZE);
+    this->stats.bytes_read += count * CELL_SIZE;
+    this->stats.syscalls++;
+    for (int64_t i = 0; i < count; i++) {
+        this->block[i] = DecodeCell((char*) &this->block[i]);
+    }
+
+    this->block_index = index;
+}
+
+// Write changed block back to file
+void BinaryTape::FlushBlock() {
+    if (!this->dirty) {
+        return;
+    }
+
+    // Cells are encoded in place, written and decoded back, so block doesn't need other buffer
+    for (auto& cell: this->block) {
+        EncodeCell(cell, (char*) &cell);
+    }
+
+    this->stream.seekp(this->block_index * this->settings.GetBlockSize() * CELL_SIZE);
+    this->stream.write((char*) this->block.data(), (std::streamsize) (this->block.size() * CELL_SIZE));
+    this->stream.flush();
+    this->stats.bytes_written += (int64_t) this->block.size() * CELL_SIZE;
+    this->stats.syscalls++;
+
+    for (auto& cell: this->block) {
+        cell = DecodeCell((char*) &cell);
+    }
+
+    this->dirty = false;
+}
+
+// Cut the tape after the head, so tape can be written again from the head position
+void BinaryTape::Truncate() {
+    if (this->GetPosition() >= this->GetN()) {
+        return;
+    }
+
+    FlushBlock();
+
+    std::filesystem::resize_file(this->file, this->GetPosition() * CELL_SIZE);
+    this->stats.syscalls++;
+    this->N = this->GetPosition();
+
+    // Block is loaded again on next access
+    this->block_index = -1;
+}
+
+BinaryTape::~BinaryTape() {
+    FlushBlock();
+}
@@ -0,0 +1,45 @@
+#ifndef TEST_BINARYTAPE_H
+#define TEST_BINARYTAPE_H
+
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <vector>
+
+#include "ITape.h"
+#include "Tape.h"
+
+// Size of one cell in binary tape file
+#define CELL_SIZE 4
+
+// BinaryTape is a class that implement ITape over file of fixed width cells
+// Every cell is int32 in little-endian byte order, so cell i starts at byte i*CELL_SIZE
+// and head can read or write any cell without parsing the file
+class BinaryTape: public BlockTape {
+public:
+    // Constructor
+    BinaryTape(const std::string& inputFileName, TapeSettings& settings);
+
+    void Truncate() override;
+
+    // Convert cell to bytes and back
+    static void EncodeCell(int32_t n, char* bytes);
+    static int32_t DecodeCell(const char* bytes);
+
+    // Override destructor
+    ~BinaryTape() override;
+protected:
+
+    // Calculate N when calling constructor
+    int64_t CalculateN(const std::string& inputFileName) const;
+
+    // Methods for work with block, compressed tape store blocks in other format
+    void LoadBlock(int64_t index) override;
+    void FlushBlock() override;
+
+    // Copying prohibited
+    BinaryTape() = default;
+};
+
+
+#endif //TEST_BINARYTAPE_H
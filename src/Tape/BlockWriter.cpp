@@ -0,0 +1,34 @@
+#include "BlockWriter.h"
+
+BlockWriter::BlockWriter(ITape *tape, int64_t buffer_size, MemoryAccount* account)
+        : buffer(BudgetAllocator<int32_t>(account)) {
+    this->tape = tape;
+    this->buffer_size = buffer_size;
+    this->buffer.reserve(buffer_size > 0 ? buffer_size : 0);
+}
+
+void BlockWriter::Write(int32_t n) {
+    if (this->buffer_size <= 0) {
+        this->tape->Write(n);
+        this->tape->ShiftLeft();
+        return;
+    }
+
+    this->buffer.push_back(n);
+    if ((int64_t) this->buffer.size() == this->buffer_size) {
+        Flush();
+    }
+}
+
+void BlockWriter::Flush() {
+    if (this->buffer.empty()) {
+        return;
+    }
+
+    this->tape->WriteBlock(this->buffer.data(), (int64_t) this->buffer.size());
+    this->buffer.clear();
+}
+
+BlockWriter::~BlockWriter() {
+    Flush();
+}
@@ -0,0 +1,32 @@
+#ifndef TEST_BLOCKWRITER_H
+#define TEST_BLOCKWRITER_H
+
+#include <cstdint>
+
+#include "ITape.h"
+#include "../Memory/BudgetAllocator.h"
+
+// BlockWriter collect numbers that written one by one and write them to tape by bulk writes
+// Buffer is written when it's full, on Flush and in destructor
+// If buffer_size == 0 every number is written to tape at once
+class BlockWriter {
+public:
+    BlockWriter(ITape* tape, int64_t buffer_size, MemoryAccount* account = nullptr);
+
+    // Copying prohibited
+    BlockWriter(const BlockWriter&) = delete;
+    BlockWriter& operator=(const BlockWriter&) = delete;
+
+    // Write number and shift head of tape
+    void Write(int32_t n);
+    void Flush();
+
+    ~BlockWriter();
+private:
+    ITape* tape;
+    int64_t buffer_size;
+    BudgetVector<int32_t> buffer;
+};
+
+
+#endif //TEST_BLOCKWRITER_H
@@ -0,0 +1,90 @@
+#include "Clock.h"
+
+#include <algorithm>
+#include <thread>
+
+// Time of thread and generation of clock when it was counted, new thread start from base time
+static thread_local int64_t thread_time = 0;
+static thread_local int64_t thread_generation = -1;
+
+Clock::Clock() : elapsed(0), base(0), generation(0) {}
+
+Clock &Clock::Global() {
+    static Clock clock;
+    return clock;
+}
+
+void Clock::Advance(std::atomic<int64_t>& device_free, std::chrono::microseconds delay) {
+    int64_t& time = ThreadTime();
+
+    // Take tape when it's free, other thread can take it at the same time, so it's checked again
+    int64_t free = device_free.load();
+    int64_t end;
+    do {
+        end = std::max(time, free) + delay.count();
+    } while (!device_free.compare_exchange_weak(free, end));
+    time = end;
+
+    int64_t current = this->elapsed.load();
+    while (current < time && !this->elapsed.compare_exchange_weak(current, time)) {
+    }
+}
+
+void Clock::WaitUntil(std::chrono::microseconds time) {
+    int64_t& current = ThreadTime();
+    current = std::max(current, (int64_t) time.count());
+}
+
+void Clock::Join() {
+    this->base = this->elapsed.load();
+    this->generation++;
+}
+
+void Clock::Reset() {
+    this->elapsed = 0;
+    this->base = 0;
+    this->generation++;
+}
+
+std::chrono::microseconds Clock::GetThreadTime() {
+    return std::chrono::microseconds(ThreadTime());
+}
+
+std::chrono::microseconds Clock::GetElapsed() const {
+    return std::chrono::microseconds(this->elapsed.load());
+}
+
+int64_t &Clock::ThreadTime() {
+    if (thread_generation != this->generation) {
+        thread_generation = this->generation;
+        thread_time = this->base;
+    }
+    return thread_time;
+}
+
+DeviceTimer::DeviceTimer(ClockMode mode) : mode(mode), device_time(0), device_free(0) {}
+
+// Real clock sleep, both clocks move timeline, so modelled time can be compared
+void DeviceTimer::Wait(std::chrono::microseconds delay) {
+    if (delay.count() <= 0) {
+        return;
+    }
+
+    if (this->mode == ClockMode::Real) {
+        std::this_thread::sleep_for(delay);
+    }
+    this->device_time += delay.count();
+    Clock::Global().Advance(this->device_free, delay);
+}
+
+void DeviceTimer::SetMode(ClockMode mode) {
+    this->mode = mode;
+}
+
+ClockMode DeviceTimer::GetMode() const {
+    return this->mode;
+}
+
+std::chrono::microseconds DeviceTimer::GetDeviceTime() const {
+    return std::chrono::microseconds(this->device_time.load());
+}
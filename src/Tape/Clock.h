@@ -0,0 +1,80 @@
+#ifndef TEST_CLOCK_H
+#define TEST_CLOCK_H
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+
+// Way to wait delays of tape operations
+enum class ClockMode {
+    // Thread sleep for delay, used for soak tests
+    Real,
+    // Delay only move time of virtual clock, so sort of large tape is modelled fast
+    Virtual
+};
+
+// Clock is shared timeline of all tapes, time is counted in microseconds
+// Every thread has own time, operation of tape move time of thread that called it
+// Tape can't start new operation before it finished previous one, so threads that use same tape wait each other,
+// threads that use different tapes move at the same time
+// Elapsed time is the largest time of all threads, it's modelled time of the whole work
+// Clock count only delays of tapes, time of computation isn't counted
+class Clock {
+public:
+    // Clock that shared by all tapes of process
+    static Clock& Global();
+
+    // Move time of current thread by delay of operation that start when both thread and tape are free
+    // device_free is time when tape become free, it's changed to end of operation
+    void Advance(std::atomic<int64_t>& device_free, std::chrono::microseconds delay);
+    // Move time of current thread to time if it's behind, thread wait for data that other thread give at that time
+    void WaitUntil(std::chrono::microseconds time);
+
+    // Threads start from the same time after Join, it should be called when other threads are not working,
+    // before they are started and after they are finished
+    void Join();
+    // Start timeline from zero
+    void Reset();
+
+    // Getters
+    std::chrono::microseconds GetThreadTime();
+    std::chrono::microseconds GetElapsed() const;
+
+private:
+    Clock();
+
+    std::atomic<int64_t> elapsed;
+    // Time of all threads after the last Join
+    std::atomic<int64_t> base;
+    // Join change generation, so threads know that their time is old
+    std::atomic<int64_t> generation;
+
+    int64_t& ThreadTime();
+};
+
+// DeviceTimer wait delays of one tape and count time that tape spent on operations
+class DeviceTimer {
+public:
+    explicit DeviceTimer(ClockMode mode = ClockMode::Real);
+
+    // Copying prohibited
+    DeviceTimer(const DeviceTimer&) = delete;
+    DeviceTimer& operator=(const DeviceTimer&) = delete;
+
+    void Wait(std::chrono::microseconds delay);
+
+    // Setter and getters
+    void SetMode(ClockMode mode);
+    ClockMode GetMode() const;
+    std::chrono::microseconds GetDeviceTime() const;
+
+private:
+    ClockMode mode;
+    // Sum of delays of tape
+    std::atomic<int64_t> device_time;
+    // Time of clock when tape become free
+    std::atomic<int64_t> device_free;
+};
+
+
+#endif //TEST_CLOCK_H
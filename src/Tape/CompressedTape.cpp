@@ -0,0 +1,373 @@
+#include "CompressedTape.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+// Zigzag encoding put small negative differences of descending runs near zero as positive ones
+static uint64_t ZigzagEncode(int64_t n) {
+    return ((uint64_t) n << 1) ^ (uint64_t) (n >> 63);
+}
+
+static int64_t ZigzagDecode(uint64_t n) {
+    return (int64_t) (n >> 1) ^ -(int64_t) (n & 1);
+}
+
+static int64_t VarintLength(uint64_t n) {
+    int64_t length = 1;
+    while (n >= 0x80) {
+        n >>= 7;
+        length++;
+    }
+    return length;
+}
+
+// CompressedTape constructor, binary tape open the file and frames are read from it
+CompressedTape::CompressedTape(const std::string& inputFileName, TapeSettings& settings)
+        : BinaryTape(inputFileName, settings) {
+    this->file_size = 0;
+    this->N = ReadFrames();
+}
+
+// Read headers of all frames, return count of numbers in file
+int64_t CompressedTape::ReadFrames() {
+    std::error_code error;
+    auto size = std::filesystem::file_size(this->file, error);
+    if (error) {
+        return 0;
+    }
+    this->file_size = (int64_t) size;
+
+    int64_t count = 0;
+    char header[FRAME_HEADER_SIZE];
+    for (int64_t offset = 0; offset + FRAME_HEADER_SIZE <= this->file_size;) {
+        this->stream.seekg(offset);
+        this->stream.read(header, FRAME_HEADER_SIZE);
+        this->stats.bytes_read += FRAME_HEADER_SIZE;
+        this->stats.syscalls++;
+
+        auto cells = (uint32_t) DecodeCell(header);
+        CompressedFrame frame{offset, DecodeCell(header + CELL_SIZE), DecodeCell(header + 2 * CELL_SIZE),
+                              count, cells & ~FRAME_RAW_FLAG, (cells & FRAME_RAW_FLAG) != 0};
+        if (frame.size < FRAME_HEADER_SIZE) {
+            break;
+        }
+        this->frames.push_back(frame);
+
+        count += frame.count;
+        offset += frame.size;
+    }
+
+    return count;
+}
+
+// Cells are overwritten by payload from the start, delta of cell i is written after cell i is read
+// and it takes at most MAX_DELTA_BYTES, so payload never reach cells that weren't read yet
+int64_t CompressedTape::EncodeFrame(int32_t* cells, int64_t count, bool& raw) {
+    // Size of payload is counted before cells are changed
+    int64_t payload = count > 0 ? CELL_SIZE : 0;
+    raw = false;
+    for (int64_t i = 1; i < count && !raw; i++) {
+        int64_t length = VarintLength(ZigzagEncode((int64_t) cells[i] - cells[i - 1]));
+        raw = length > MAX_DELTA_BYTES;
+        payload += length;
+    }
+
+    auto bytes = (char*) cells;
+    if (raw || payload >= count * CELL_SIZE) {
+        raw = true;
+        for (int64_t i = 0; i < count; i++) {
+            EncodeCell(cells[i], bytes + i * CELL_SIZE);
+        }
+        return count * CELL_SIZE;
+    }
+
+    int32_t previous = cells[0];
+    EncodeCell(previous, bytes);
+    int64_t used = CELL_SIZE;
+    for (int64_t i = 1; i < count; i++) {
+        int32_t value = cells[i];
+        uint64_t delta = ZigzagEncode((int64_t) value - previous);
+        while (delta >= 0x80) {
+            bytes[used++] = (char) ((delta & 0x7F) | 0x80);
+            delta >>= 7;
+        }
+        bytes[used++] = (char) delta;
+        previous = value;
+    }
+
+    return used;
+}
+
+// Payload is stored in the end of memory of capacity cells and cells are decoded from the start
+// Every delta take at most MAX_DELTA_BYTES, so decoded cells never reach bytes that weren't read yet
+void CompressedTape::DecodeFrame(int32_t* cells, int64_t count, int64_t capacity, int64_t payload, bool raw) {
+    auto bytes = (const char*) cells + capacity * CELL_SIZE - payload;
+    if (raw) {
+        for (int64_t i = 0; i < count; i++) {
+            cells[i] = DecodeCell(bytes + i * CELL_SIZE);
+        }
+        return;
+    }
+
+    if (count == 0) {
+        return;
+    }
+    int32_t previous = DecodeCell(bytes);
+    cells[0] = previous;
+    int64_t used = CELL_SIZE;
+    for (int64_t i = 1; i < count; i++) {
+        uint64_t delta = 0;
+        int shift = 0;
+        unsigned char byte;
+        do {
+            byte = (unsigned char) bytes[used++];
+            delta |= (uint64_t) (byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        previous = (int32_t) (previous + ZigzagDecode(delta));
+        cells[i] = previous;
+    }
+}
+
+// Load block with index to memory, payload of its frame is read by one call
+// Block that isn't kept by one frame is copied from decoded frames
+void CompressedTape::LoadBlock(int64_t index) {
+    if (index == this->block_index) {
+        return;
+    }
+
+    FlushBlock();
+
+    int64_t size = this->settings.GetBlockSize();
+    int64_t begin = index * size;
+    int64_t count = std::min(size, this->GetN() - begin);
+
+    this->block.clear();
+    this->block.resize(size);
+    if (count > 0) {
+        int64_t i = FindFrame(begin);
+        auto& frame = this->frames[i];
+        if (frame.first == begin && frame.count == count) {
+            this->stream.seekg(frame.offset + FRAME_HEADER_SIZE);
+            this->stream.read((char*) this->block.data() + size * CELL_SIZE - frame.payload, frame.payload);
+            this->stats.bytes_read += frame.payload;
+            this->stats.syscalls++;
+
+            DecodeFrame(this->block.data(), count, size, frame.payload, frame.raw);
+        } else {
+            std::vector<int32_t> cells;
+            for (int64_t loaded = 0; loaded < count; i++) {
+                ReadFrame(this->frames[i], cells);
+                int64_t skip = begin + loaded - this->frames[i].first;
+                int64_t part = std::min(count - loaded, this->frames[i].count - skip);
+                std::copy_n(cells.begin() + skip, part, this->block.begin() + loaded);
+                loaded += part;
+            }
+        }
+    }
+    this->block.resize(count);
+
+    this->block_index = index;
+}
+
+// Write changed block as frame in place of frames that kept its cells
+// Cells of these frames before and after block are written as own frames, so file keep all numbers
+// The last frame is rewritten in its place, other frames keep their size if new frames fit them
+void CompressedTape::FlushBlock() {
+    if (!this->dirty) {
+        return;
+    }
+
+    int64_t size = this->settings.GetBlockSize();
+    auto count = (int64_t) this->block.size();
+    int64_t begin = this->block_index * size;
+    int64_t end = begin + count;
+
+    // Frames [first, last) keep cells of block, block after the last frame is appended to the end of file
+    int64_t first = FindFrame(begin);
+    int64_t last = first;
+    while (last < (int64_t) this->frames.size() && this->frames[last].first < end) {
+        last++;
+    }
+    bool tail = last == (int64_t) this->frames.size();
+    int64_t offset = first < last ? this->frames[first].offset : GetFileSize();
+    int64_t old_end = first < last ? this->frames[last - 1].offset + this->frames[last - 1].size : offset;
+
+    std::vector<int32_t> prefix;
+    std::vector<int32_t> suffix;
+    if (first < last && this->frames[first].first < begin) {
+        ReadFrame(this->frames[first], prefix);
+        prefix.resize(begin - this->frames[first].first);
+    }
+    if (first < last) {
+        auto& back = this->frames[last - 1];
+        // Cells after the end of tape were cut
+        int64_t back_end = std::min(back.first + back.count, this->GetN());
+        if (back_end > end) {
+            ReadFrame(back, suffix);
+            suffix.erase(suffix.begin(), suffix.begin() + (end - back.first));
+            suffix.resize(back_end - end);
+        }
+    }
+
+    // Cells are encoded in place, block is the second of three parts, empty parts don't get frame
+    int32_t* parts[3] = {prefix.data(), this->block.data(), suffix.data()};
+    int64_t counts[3] = {(int64_t) prefix.size(), count, (int64_t) suffix.size()};
+    CompressedFrame written[3];
+    int64_t cell = begin - counts[0];
+    int last_written = -1;
+    for (int j = 0; j < 3; j++) {
+        written[j] = CompressedFrame{offset, 0, 0, cell, counts[j], false};
+        if (counts[j] > 0) {
+            written[j].payload = EncodeFrame(parts[j], counts[j], written[j].raw);
+            written[j].size = FRAME_HEADER_SIZE + written[j].payload;
+            offset += written[j].size;
+            cell += counts[j];
+            last_written = j;
+        }
+    }
+
+    // Longer frames move the rest of file, shorter ones keep old place
+    if (!tail && offset > old_end) {
+        MoveTail(old_end, offset - old_end);
+    } else if (!tail && last_written >= 0) {
+        written[last_written].size += old_end - offset;
+    }
+
+    this->frames.erase(this->frames.begin() + first, this->frames.begin() + last);
+    for (int j = 0; j < 3; j++) {
+        if (counts[j] > 0) {
+            WriteFrame(written[j], parts[j]);
+            this->stats.bytes_written += FRAME_HEADER_SIZE + written[j].payload;
+            this->frames.insert(this->frames.begin() + first++, written[j]);
+        }
+    }
+    this->stream.flush();
+
+    // Shorter last frame leave old bytes in the end of file
+    if (tail) {
+        int64_t file_end = GetFileSize();
+        if (this->file_size > file_end) {
+            std::filesystem::resize_file(this->file, file_end);
+            this->stats.syscalls++;
+        }
+        this->file_size = file_end;
+    }
+
+    // Payload is moved to the end of block memory and decoded back, so block doesn't need other buffer
+    int64_t payload = written[1].payload;
+    this->block.resize(size);
+    auto bytes = (char*) this->block.data();
+    std::memmove(bytes + size * CELL_SIZE - payload, bytes, payload);
+    DecodeFrame(this->block.data(), count, size, payload, written[1].raw);
+    this->block.resize(count);
+
+    this->dirty = false;
+}
+
+// Move all bytes of file from offset to the right by delta, it's needed when frame become longer
+void CompressedTape::MoveTail(int64_t offset, int64_t delta) {
+    std::vector<char> buffer(MOVE_BUFFER_SIZE);
+
+    int64_t end = this->file_size;
+    while (end > offset) {
+        int64_t begin = std::max(offset, end - (int64_t) buffer.size());
+
+        this->stream.seekg(begin);
+        this->stream.read(buffer.data(), end - begin);
+        this->stream.seekp(begin + delta);
+        this->stream.write(buffer.data(), end - begin);
+
+        this->stats.bytes_read += end - begin;
+        this->stats.bytes_written += end - begin;
+        this->stats.syscalls += 2;
+
+        end = begin;
+    }
+
+    this->file_size += delta;
+
+    for (auto& frame: this->frames) {
+        if (frame.offset >= offset) {
+            frame.offset += delta;
+        }
+    }
+}
+
+// Cut the tape after the head, block under the head is written again with fewer numbers
+void CompressedTape::Truncate() {
+    if (this->GetPosition() >= this->GetN()) {
+        return;
+    }
+
+    FlushBlock();
+
+    int64_t size = this->settings.GetBlockSize();
+    int64_t index = this->GetPosition() / size;
+    int64_t frame = FindFrame(this->GetPosition());
+    if (this->frames[frame].first < this->GetPosition()) {
+        LoadBlock(index);
+        this->block.resize(this->GetPosition() - index * size);
+        this->frames.resize(frame + 1);
+        this->N = this->GetPosition();
+        this->dirty = true;
+        FlushBlock();
+        return;
+    }
+
+    this->frames.resize(frame);
+    this->N = this->GetPosition();
+    this->file_size = GetFileSize();
+    std::filesystem::resize_file(this->file, this->file_size);
+    this->stats.syscalls++;
+
+    // Block is loaded again on next access
+    this->block_index = -1;
+}
+
+int64_t CompressedTape::FindFrame(int64_t cell) const {
+    auto next = std::upper_bound(this->frames.begin(), this->frames.end(), cell,
+                                 [](int64_t value, const CompressedFrame& frame) { return value < frame.first; });
+    if (next == this->frames.begin() || cell >= (next - 1)->first + (next - 1)->count) {
+        return (int64_t) this->frames.size();
+    }
+
+    return next - this->frames.begin() - 1;
+}
+
+void CompressedTape::ReadFrame(const CompressedFrame& frame, std::vector<int32_t>& cells) {
+    cells.assign(frame.count, 0);
+    this->stream.seekg(frame.offset + FRAME_HEADER_SIZE);
+    this->stream.read((char*) cells.data() + frame.count * CELL_SIZE - frame.payload, frame.payload);
+    this->stats.bytes_read += frame.payload;
+    this->stats.syscalls++;
+
+    DecodeFrame(cells.data(), frame.count, frame.count, frame.payload, frame.raw);
+}
+
+void CompressedTape::WriteFrame(const CompressedFrame& frame, const int32_t* payload) {
+    char header[FRAME_HEADER_SIZE];
+    EncodeCell((int32_t) ((uint32_t) frame.count | (frame.raw ? FRAME_RAW_FLAG : 0)), header);
+    EncodeCell((int32_t) frame.size, header + CELL_SIZE);
+    EncodeCell((int32_t) frame.payload, header + 2 * CELL_SIZE);
+
+    this->stream.seekp(frame.offset);
+    this->stream.write(header, FRAME_HEADER_SIZE);
+    this->stream.write((const char*) payload, (std::streamsize) frame.payload);
+    this->stats.syscalls += 2;
+}
+
+int64_t CompressedTape::GetFileSize() const {
+    if (this->frames.empty()) {
+        return 0;
+    }
+
+    return this->frames.back().offset + this->frames.back().size;
+}
+
+// Block is flushed here, destructor of binary tape can't call FlushBlock of compressed tape
+CompressedTape::~CompressedTape() {
+    FlushBlock();
+}
@@ -0,0 +1,80 @@
+#ifndef TEST_COMPRESSEDTAPE_H
+#define TEST_COMPRESSEDTAPE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BinaryTape.h"
+
+// Size of frame header in bytes: count of numbers with raw flag, size of frame and size of payload
+#define FRAME_HEADER_SIZE 12
+// Flag of count field, payload of frame store numbers as binary cells
+#define FRAME_RAW_FLAG 0x80000000u
+// Delta is written by at most 4 bytes of varint, bigger deltas make frame raw
+#define MAX_DELTA_BYTES 4
+
+// Frame of compressed tape file that store one block
+// File could be written with other block size, so frame know what cells it keep
+struct CompressedFrame {
+    // Offset of header in file
+    int64_t offset;
+    // Bytes of frame with header, frame can be longer than header and payload after block became shorter
+    int64_t size;
+    // Bytes of encoded numbers
+    int64_t payload;
+    // Count of cells before frame and in frame
+    int64_t first;
+    int64_t count;
+    bool raw;
+};
+
+// CompressedTape is a binary tape that store every block as frame of delta encoded numbers
+// Frame is header and payload: the first number as cell and varints of zigzag encoded differences
+// of neighbour numbers, numbers of sorted runs differ a bit, so most of them take one or two bytes
+// If encoded block isn't shorter than cells, payload keep cells as binary tape do
+// Offsets of frames are read from headers when tape is opened, so any block can be loaded by one read
+// Frame that become longer after change in the middle of tape move the rest of file as text tape do
+// Frame of cell is found by binary search over counts of cells before frames, if file was written with other block
+// size block is taken from several frames and frames at the borders of changed block are split
+class CompressedTape: public BinaryTape {
+public:
+    // Constructor
+    CompressedTape(const std::string& inputFileName, TapeSettings& settings);
+
+    // Copying prohibited
+    CompressedTape(const CompressedTape&) = delete;
+    CompressedTape& operator=(const CompressedTape&) = delete;
+
+    void Truncate() override;
+
+    // Bytes of file, it's less than N*CELL_SIZE for sorted numbers
+    int64_t GetFileSize() const;
+
+    // Encode cells in place to payload and back
+    // Payload can't be longer than cells, so it is stored in memory of cells
+    static int64_t EncodeFrame(int32_t* cells, int64_t count, bool& raw);
+    static void DecodeFrame(int32_t* cells, int64_t count, int64_t capacity, int64_t payload, bool raw);
+
+    ~CompressedTape() override;
+private:
+    // Frame of every block
+    // Index grows with length of tape by 48 bytes for block, so it isn't counted by memory account like index of
+    // text tape, block itself take more memory
+    std::vector<CompressedFrame> frames;
+    // Bytes in file, it can be more than end of the last frame until file is cut
+    int64_t file_size;
+
+    int64_t ReadFrames();
+    // Index of frame that keep cell, count of frames if cell is after the last frame
+    int64_t FindFrame(int64_t cell) const;
+    // Read and decode all cells of frame, it's used only for frames that don't match blocks
+    void ReadFrame(const CompressedFrame& frame, std::vector<int32_t>& cells);
+    void WriteFrame(const CompressedFrame& frame, const int32_t* payload);
+    void LoadBlock(int64_t index) override;
+    void FlushBlock() override;
+    void MoveTail(int64_t offset, int64_t delta);
+};
+
+
+#endif //TEST_COMPRESSEDTAPE_H
@@ -2,6 +2,9 @@
 #define TEST_ITAPE_H
 
 #include <cstdint>
+#include <chrono>
+
+#include "TapeStats.h"
 
 // Interface for work with tape
 class ITape {
@@ -12,10 +15,48 @@ public:
     virtual void ShiftLeft() = 0;
     virtual void ShiftRight() = 0;
     virtual void Rewind() = 0;
+    // Cut cells after the head, head position become N
+    virtual void Truncate() = 0;
+
+    // Bulk methods, head is shifted after the last read or written number
+    // Read count numbers from the head, reading stop in the end of tape, return count of read numbers
+    virtual int64_t ReadBlock(int32_t* values, int64_t count) {
+        int64_t i = 0;
+        for (; i < count && GetPosition() < GetN(); i++) {
+            values[i] = Read();
+            ShiftLeft();
+        }
+        return i;
+    }
+    // Read count numbers before the head from right to left, head stop on the last read number
+    // Reading stop in the start of tape, return count of read numbers
+    virtual int64_t ReadBlockBackward(int32_t* values, int64_t count) {
+        int64_t i = 0;
+        for (; i < count && GetPosition() > 0; i++) {
+            ShiftRight();
+            values[i] = Read();
+        }
+        return i;
+    }
+    // Write count numbers from the head, numbers after the end of tape are appended
+    virtual void WriteBlock(const int32_t* values, int64_t count) {
+        for (int64_t i = 0; i < count; i++) {
+            Write(values[i]);
+            ShiftLeft();
+        }
+    }
 
     // Getters
     virtual int64_t GetN() const = 0;
     virtual int64_t GetPosition() const = 0;
+    // Time that tape spent on operations, tapes without delays return 0
+    virtual std::chrono::microseconds GetDeviceTime() const {
+        return std::chrono::microseconds(0);
+    }
+    // Counters of tape operations, tapes without counters return zeros
+    virtual TapeStats GetStats() const {
+        return TapeStats();
+    }
 
     // Virtual destructor
     virtual ~ITape() {};
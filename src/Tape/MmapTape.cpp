@@ -0,0 +1,291 @@
+#include "MmapTape.h"
+#include "BinaryTape.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// MmapTape constructor
+MmapTape::MmapTape(const std::string& inputFileName, TapeSettings& settings) {
+    // Copy fields
+    this->position = 0;
+    this->file = inputFileName;
+    this->settings = settings;
+    this->timer.SetMode(settings.GetClockMode());
+    this->data = nullptr;
+    this->capacity = 0;
+    this->advised = 0;
+    this->writable = true;
+
+    // Create file if it doesn't exist as BinaryTape do, read-only file still can be read as input tape
+    this->fd = open(inputFileName.c_str(), O_RDWR | O_CREAT, 0644);
+    if (this->fd < 0 && (errno == EACCES || errno == EROFS)) {
+        this->fd = open(inputFileName.c_str(), O_RDONLY);
+        this->writable = false;
+    }
+    if (this->fd < 0) {
+        throw std::runtime_error("Can't open tape file " + inputFileName);
+    }
+
+    // N is calculated by size of file as in BinaryTape
+    struct stat info{};
+    if (fstat(this->fd, &info) != 0) {
+        close(this->fd);
+        throw std::runtime_error("Can't get size of tape file " + inputFileName);
+    }
+    if (info.st_size % CELL_SIZE != 0) {
+        close(this->fd);
+        throw std::runtime_error("Size of tape file " + inputFileName + " isn't multiple of cell size");
+    }
+    this->N = info.st_size / CELL_SIZE;
+    this->stats.syscalls += 2;
+
+    // File is mapped as it is, it's resized only when write pass the end of mapping
+    // Empty file can't be mapped, so it's mapped by the first write
+    if (this->N > 0) {
+        Map(this->N);
+    }
+}
+
+// Map cells of file to memory, file should have at least so many cells
+void MmapTape::Map(int64_t cells) {
+    int protection = this->writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* memory = mmap(nullptr, cells * CELL_SIZE, protection, MAP_SHARED, this->fd, 0);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("Can't map tape file " + this->file);
+    }
+
+    // Sorter read and write tapes from start to end
+    if (madvise(memory, cells * CELL_SIZE, MADV_SEQUENTIAL) != 0) {
+        throw std::runtime_error("Can't advise pages of tape file " + this->file);
+    }
+    this->stats.syscalls += 2;
+
+    this->data = (char*) memory;
+    this->capacity = cells;
+}
+
+void MmapTape::Unmap() {
+    if (this->data != nullptr) {
+        munmap(this->data, this->capacity * CELL_SIZE);
+        this->stats.syscalls++;
+        this->data = nullptr;
+    }
+}
+
+// Resize file by one more chunk and map it again
+// Cells after N are cut from file when tape is closed
+void MmapTape::Grow() {
+    int64_t cells = this->capacity + MMAP_CHUNK_SIZE;
+    if (ftruncate(this->fd, cells * CELL_SIZE) != 0) {
+        throw std::runtime_error("Can't resize tape file " + this->file);
+    }
+    this->stats.syscalls++;
+
+    Unmap();
+    Map(cells);
+}
+
+void MmapTape::Write(int32_t n) {
+    if (!this->writable) {
+        throw std::runtime_error("Can't write read-only tape file " + this->file);
+    }
+    // Wait delay
+    this->timer.Wait(std::chrono::milliseconds(this->settings.GetWriteDelay()));
+    this->stats.writes++;
+
+    if (this->GetPosition() == this->GetN()) {
+        if (this->GetN() == this->capacity) {
+            Grow();
+        }
+        this->N++;
+    }
+
+    BinaryTape::EncodeCell(n, this->data + this->GetPosition() * CELL_SIZE);
+    this->stats.bytes_written += CELL_SIZE;
+}
+
+int32_t MmapTape::Read() {
+    // Wait delay
+    this->timer.Wait(std::chrono::milliseconds(this->settings.GetReadDelay()));
+    this->stats.reads++;
+
+    if (this->GetN() == 0) {
+        return 0;
+    }
+
+    // Head in the end of the tape see last number as text tape do
+    int64_t cell = std::min(this->GetPosition(), this->GetN() - 1);
+    this->stats.bytes_read += CELL_SIZE;
+
+    return BinaryTape::DecodeCell(this->data + cell * CELL_SIZE);
+}
+
+void MmapTape::ShiftLeft() {
+    // Cant shift to left if position==N
+    if (this->GetPosition() < this->GetN()) {
+        this->timer.Wait(std::chrono::milliseconds(this->settings.GetShiftDelay()));
+        this->stats.shifts_left++;
+        this->position++;
+        Advise();
+    }
+}
+
+// madvise take only page aligned address, so offsets in mapping are rounded down to page border
+static int64_t PageFloor(int64_t offset) {
+    static const int64_t page = sysconf(_SC_PAGESIZE);
+    return offset / page * page;
+}
+
+// Pages far behind the head will not be needed in this pass
+void MmapTape::Advise() {
+    int64_t behind = PageFloor(this->GetPosition() * CELL_SIZE - MMAP_ADVISE_SIZE);
+    if (behind - this->advised >= MMAP_ADVISE_SIZE) {
+        if (madvise(this->data + this->advised, behind - this->advised, MADV_DONTNEED) != 0) {
+            throw std::runtime_error("Can't release pages of tape file " + this->file);
+        }
+        this->stats.syscalls++;
+        this->advised = behind;
+    }
+}
+
+// Read numbers straight from mapped memory, delay is counted for the whole operation
+int64_t MmapTape::ReadBlock(int32_t *values, int64_t count) {
+    count = std::max<int64_t>(0, std::min(count, this->GetN() - this->GetPosition()));
+    this->timer.Wait(this->settings.GetBlockDelay(this->settings.GetReadDelay(), count));
+    this->stats.reads += count;
+    this->stats.shifts_left += count;
+
+    for (int64_t i = 0; i < count; i++) {
+        values[i] = BinaryTape::DecodeCell(this->data + (this->GetPosition() + i) * CELL_SIZE);
+    }
+    this->stats.bytes_read += count * CELL_SIZE;
+    this->position += count;
+    Advise();
+
+    return count;
+}
+
+// Read numbers before the head straight from mapped memory
+int64_t MmapTape::ReadBlockBackward(int32_t *values, int64_t count) {
+    count = std::max<int64_t>(0, std::min(count, this->GetPosition()));
+    this->timer.Wait(this->settings.GetBlockDelay(this->settings.GetReadDelay(), count));
+    this->stats.reads += count;
+    this->stats.shifts_right += count;
+
+    for (int64_t i = 0; i < count; i++) {
+        values[i] = BinaryTape::DecodeCell(this->data + (this->GetPosition() - 1 - i) * CELL_SIZE);
+    }
+    this->stats.bytes_read += count * CELL_SIZE;
+    this->position -= count;
+
+    // Released pages will be loaded again by page fault
+    this->advised = PageFloor(std::min(this->advised, this->GetPosition() * CELL_SIZE));
+
+    return count;
+}
+
+// Write numbers straight to mapped memory, file grows by chunks while numbers don't fit
+void MmapTape::WriteBlock(const int32_t *values, int64_t count) {
+    if (!this->writable) {
+        throw std::runtime_error("Can't write read-only tape file " + this->file);
+    }
+    this->timer.Wait(this->settings.GetBlockDelay(this->settings.GetWriteDelay(), count));
+    this->stats.writes += count;
+    this->stats.shifts_left += count;
+
+    while (this->GetPosition() + count > this->capacity) {
+        Grow();
+    }
+    for (int64_t i = 0; i < count; i++) {
+        BinaryTape::EncodeCell(values[i], this->data + (this->GetPosition() + i) * CELL_SIZE);
+    }
+    this->stats.bytes_written += count * CELL_SIZE;
+    this->position += count;
+    this->N = std::max(this->GetN(), this->GetPosition());
+    Advise();
+}
+
+void MmapTape::ShiftRight() {
+    // Cant shift to right if position==0
+    if (this->GetPosition() > 0) {
+        this->timer.Wait(std::chrono::milliseconds(this->settings.GetShiftDelay()));
+        this->stats.shifts_right++;
+        this->position--;
+
+        // Released pages will be loaded again by page fault
+        this->advised = PageFloor(std::min(this->advised, this->GetPosition() * CELL_SIZE));
+    }
+}
+
+void MmapTape::Rewind() {
+    this->timer.Wait(this->settings.GetRewindTime(this->GetPosition()));
+    this->stats.rewinds++;
+
+    this->position = 0;
+    this->advised = 0;
+    if (this->capacity > 0 && madvise(this->data, this->capacity * CELL_SIZE, MADV_SEQUENTIAL) != 0) {
+        throw std::runtime_error("Can't advise pages of tape file " + this->file);
+    }
+    this->stats.syscalls++;
+}
+
+// Cut the tape after the head, file is resized when tape is closed
+void MmapTape::Truncate() {
+    if (this->GetPosition() < this->GetN()) {
+        if (!this->writable) {
+            throw std::runtime_error("Can't truncate read-only tape file " + this->file);
+        }
+        this->N = this->GetPosition();
+    }
+}
+
+int64_t MmapTape::GetN() const {
+    return this->N;
+}
+
+int64_t MmapTape::GetPosition() const {
+    return this->position;
+}
+
+std::chrono::microseconds MmapTape::GetDeviceTime() const {
+    return this->timer.GetDeviceTime();
+}
+
+TapeStats MmapTape::GetStats() const {
+    TapeStats stats = this->stats;
+    stats.delay = this->timer.GetDeviceTime().count();
+
+    return stats;
+}
+
+std::string MmapTape::GetFileName() const {
+    return this->file;
+}
+
+// File is cut to N cells, so it can be opened as binary tape
+MmapTape::~MmapTape() {
+    Unmap();
+    if (this->fd >= 0) {
+        // Nothing can be done in destructor if file can't be resized
+        if (this->writable) {
+            [[maybe_unused]] int result = ftruncate(this->fd, this->N * CELL_SIZE);
+            this->stats.syscalls++;
+        }
+        close(this->fd);
+        this->stats.syscalls++;
+    }
+
+    if (this->settings.GetStatsAccount() != nullptr) {
+        this->settings.GetStatsAccount()->Add(GetStats());
+    }
+}
+
+#endif
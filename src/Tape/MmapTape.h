@@ -0,0 +1,72 @@
+#ifndef TEST_MMAPTAPE_H
+#define TEST_MMAPTAPE_H
+
+#include <cstdint>
+#include <string>
+
+#include "ITape.h"
+#include "Tape.h"
+
+// File is grown by this count of cells when head write in the end of the tape
+#define MMAP_CHUNK_SIZE (1 << 20)
+// Size of window in bytes behind the head that is kept in memory while head move forward
+#define MMAP_ADVISE_SIZE (1 << 22)
+
+// MmapTape is a class that implement ITape over memory mapped file
+// File has same format as BinaryTape file, so both classes can open tapes of each other
+// Reads and writes are loads and stores in mapped memory, file is mapped as it is and grown by big chunks by writes
+// Counted bytes are bytes loaded and stored in mapped memory, counted syscalls are calls that work with mapping
+class MmapTape: public ITape {
+public:
+    // Constructor
+    MmapTape(const std::string& inputFileName, TapeSettings& settings);
+
+    // Methods to work with tape
+    int32_t Read() override;
+    void Write(int32_t n) override;
+    void ShiftLeft() override;
+    void ShiftRight() override;
+    void Rewind() override;
+    void Truncate() override;
+    int64_t ReadBlock(int32_t* values, int64_t count) override;
+    int64_t ReadBlockBackward(int32_t* values, int64_t count) override;
+    void WriteBlock(const int32_t* values, int64_t count) override;
+
+    // Some getters
+    std::string GetFileName() const;
+    int64_t GetN() const override;
+    int64_t GetPosition() const override;
+    std::chrono::microseconds GetDeviceTime() const override;
+    TapeStats GetStats() const override;
+
+    // Override destructor
+    ~MmapTape() override;
+private:
+
+    TapeSettings settings;
+    DeviceTimer timer;
+    TapeStats stats;
+    std::string file;
+
+    // File descriptor and mapped memory
+    int fd;
+    char* data;
+    // Count of mapped cells, file can store them without growing
+    int64_t capacity;
+    // False if file is opened read-only, then writes throw
+    bool writable;
+    // Start of memory that wasn't released by MADV_DONTNEED yet
+    int64_t advised;
+
+    // Methods to work with mapping
+    void Map(int64_t cells);
+    void Unmap();
+    void Grow();
+    void Advise();
+
+    // Copying prohibited
+    MmapTape() = default;
+};
+
+
+#endif //TEST_MMAPTAPE_H
@@ -0,0 +1,343 @@
+#include "PrefetchingTape.h"
+
+#include <algorithm>
+
+#include "Clock.h"
+
+PrefetchingTape::PrefetchingTape(ITape *tape, int32_t buffer_size, MemoryAccount* account)
+        : buffer(BudgetAllocator<int32_t>(account)), stamps(BudgetAllocator<int64_t>(account)) {
+    this->tape = tape;
+    this->mode = PrefetchMode::Idle;
+    this->N = tape->GetN();
+    this->position = tape->GetPosition();
+
+    this->buffer.resize(std::max(1, buffer_size));
+    this->buffer_begin = 0;
+    this->buffer_count = 0;
+    this->stamps.resize(this->buffer.size(), 0);
+
+    this->pending = 0;
+    this->has_pending = false;
+
+    this->busy = false;
+    this->stopped = false;
+    this->worker = std::thread(&PrefetchingTape::Work, this);
+}
+
+// Read number under the head
+// Number is taken from buffer, so only first Read after change of direction wait delay of wrapped tape
+int32_t PrefetchingTape::Read() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    if (this->mode == PrefetchMode::Writing && this->has_pending) {
+        return this->pending;
+    }
+
+    // Head in the end of tape read last number of wrapped tape
+    if (this->GetPosition() >= this->GetN()) {
+        Sync(lock);
+        return this->tape->Read();
+    }
+
+    if (this->mode != PrefetchMode::Reading) {
+        Sync(lock);
+        this->mode = PrefetchMode::Reading;
+        this->worker_wait.notify_one();
+    }
+
+    this->tape_wait.wait(lock, [this] { return this->buffer_count > 0; });
+    Take(this->buffer_begin, 1);
+    return this->buffer[this->buffer_begin];
+}
+
+// Write number under the head, it's written to wrapped tape when head is shifted
+void PrefetchingTape::Write(int32_t n) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    if (this->mode != PrefetchMode::Writing) {
+        Sync(lock);
+        this->mode = PrefetchMode::Writing;
+    }
+
+    // Head in the end of tape append number
+    if (this->GetPosition() == this->GetN()) {
+        this->N++;
+    }
+    this->pending = n;
+    this->has_pending = true;
+}
+
+void PrefetchingTape::ShiftLeft() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    // Cant shift to left if position==N
+    if (this->GetPosition() >= this->GetN()) {
+        return;
+    }
+
+    if (this->mode == PrefetchMode::Writing && this->has_pending) {
+        // Wait for place in queue of written numbers
+        this->tape_wait.wait(lock, [this] { return this->buffer_count < this->buffer.size(); });
+        size_t end = (this->buffer_begin + this->buffer_count) % this->buffer.size();
+        Take(end, 1);
+        PushBuffer(this->pending);
+        Give(end, 1);
+        this->has_pending = false;
+        this->worker_wait.notify_one();
+    } else {
+        if (this->mode != PrefetchMode::Reading) {
+            Sync(lock);
+            this->mode = PrefetchMode::Reading;
+            this->worker_wait.notify_one();
+        }
+
+        // Number under the head is dropped from buffer
+        this->tape_wait.wait(lock, [this] { return this->buffer_count > 0; });
+        size_t begin = this->buffer_begin;
+        Take(begin, 1);
+        PopBuffer();
+        Give(begin, 1);
+        this->worker_wait.notify_one();
+    }
+    this->position++;
+}
+
+// Change of direction drop buffer
+void PrefetchingTape::ShiftRight() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    Sync(lock);
+
+    this->tape->ShiftRight();
+    this->position = this->tape->GetPosition();
+}
+
+void PrefetchingTape::Rewind() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    // Numbers that were read ahead are dropped without moving wrapped tape back
+    Drop(lock);
+    Sync(lock);
+
+    this->tape->Rewind();
+    this->position = 0;
+}
+
+void PrefetchingTape::Truncate() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    Sync(lock);
+
+    this->tape->Truncate();
+    this->N = this->tape->GetN();
+}
+
+// Numbers are copied from buffer by contiguous parts of ring
+int64_t PrefetchingTape::ReadBlock(int32_t *values, int64_t count) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    count = std::max<int64_t>(0, std::min(count, this->GetN() - this->GetPosition()));
+    if (count == 0) {
+        return 0;
+    }
+    if (this->mode != PrefetchMode::Reading) {
+        Sync(lock);
+        this->mode = PrefetchMode::Reading;
+        this->worker_wait.notify_one();
+    }
+
+    int64_t read = 0;
+    while (read < count) {
+        this->tape_wait.wait(lock, [this] { return this->buffer_count > 0; });
+        auto part = (int64_t) std::min(this->buffer_count, this->buffer.size() - this->buffer_begin);
+        part = std::min(part, count - read);
+        Take(this->buffer_begin, part);
+        std::copy_n(this->buffer.begin() + (int64_t) this->buffer_begin, part, values + read);
+        Give(this->buffer_begin, part);
+        this->buffer_begin = (this->buffer_begin + part) % this->buffer.size();
+        this->buffer_count -= part;
+        read += part;
+        this->worker_wait.notify_one();
+    }
+    this->position += count;
+
+    return count;
+}
+
+// Numbers are queued to buffer by contiguous parts of ring, number under the head is replaced by the first of them
+void PrefetchingTape::WriteBlock(const int32_t *values, int64_t count) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    if (count <= 0) {
+        return;
+    }
+    if (this->mode != PrefetchMode::Writing) {
+        Sync(lock);
+        this->mode = PrefetchMode::Writing;
+    }
+    this->has_pending = false;
+
+    int64_t written = 0;
+    while (written < count) {
+        this->tape_wait.wait(lock, [this] { return this->buffer_count < this->buffer.size(); });
+        size_t end = (this->buffer_begin + this->buffer_count) % this->buffer.size();
+        auto part = (int64_t) std::min(this->buffer.size() - this->buffer_count, this->buffer.size() - end);
+        part = std::min(part, count - written);
+        Take(end, part);
+        std::copy_n(values + written, part, this->buffer.begin() + (int64_t) end);
+        Give(end, part);
+        this->buffer_count += part;
+        written += part;
+        this->worker_wait.notify_one();
+    }
+    this->position += count;
+    this->N = std::max(this->GetN(), this->GetPosition());
+}
+
+// Numbers before the head can't be read ahead, so they are read by wrapped tape
+int64_t PrefetchingTape::ReadBlockBackward(int32_t *values, int64_t count) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    Sync(lock);
+
+    count = this->tape->ReadBlockBackward(values, count);
+    this->position = this->tape->GetPosition();
+
+    return count;
+}
+
+int64_t PrefetchingTape::GetN() const {
+    return this->N;
+}
+
+int64_t PrefetchingTape::GetPosition() const {
+    return this->position;
+}
+
+std::chrono::microseconds PrefetchingTape::GetDeviceTime() const {
+    return this->tape->GetDeviceTime();
+}
+
+TapeStats PrefetchingTape::GetStats() const {
+    return this->tape->GetStats();
+}
+
+// Move head of wrapped tape to the head and stop background thread
+// Queued numbers are written, numbers that were read ahead are dropped
+void PrefetchingTape::Sync(std::unique_lock<std::mutex>& lock) {
+    if (this->mode == PrefetchMode::Writing) {
+        this->tape_wait.wait(lock, [this] { return this->buffer_count == 0 && !this->busy; });
+        if (this->has_pending) {
+            this->tape->Write(this->pending);
+            this->has_pending = false;
+        }
+        // Thread wait while all queued numbers are written
+        Take(0, (int64_t) this->buffer.size());
+    } else if (this->mode == PrefetchMode::Reading) {
+        Drop(lock);
+        while (this->tape->GetPosition() > this->GetPosition()) {
+            this->tape->ShiftRight();
+        }
+    }
+
+    // Background thread start new direction after thread that changed it
+    Give(0, (int64_t) this->buffer.size());
+    this->mode = PrefetchMode::Idle;
+}
+
+// Stop reading ahead and drop numbers that were read, head of wrapped tape stay after them
+void PrefetchingTape::Drop(std::unique_lock<std::mutex>& lock) {
+    if (this->mode != PrefetchMode::Reading) {
+        return;
+    }
+
+    this->mode = PrefetchMode::Idle;
+    this->tape_wait.wait(lock, [this] { return !this->busy; });
+    this->buffer_count = 0;
+}
+
+// Background thread
+// Wrapped tape is used without lock, so other thread can take numbers from buffer at the same time
+// Reading fill free part of ring after queued numbers, it's at most half of buffer, so reader don't wait
+// for the whole buffer, writing write all queued numbers till the end of ring
+// Other thread only take numbers from the start of queue or add them to the end of it, so these parts aren't changed
+void PrefetchingTape::Work() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        this->worker_wait.wait(lock, [this] {
+            return this->stopped ||
+                   (this->mode == PrefetchMode::Reading && this->buffer_count < this->buffer.size() &&
+                    this->tape->GetPosition() < this->tape->GetN()) ||
+                   (this->mode == PrefetchMode::Writing && this->buffer_count > 0);
+        });
+        if (this->stopped) {
+            return;
+        }
+
+        this->busy = true;
+        size_t size = this->buffer.size();
+        if (this->mode == PrefetchMode::Reading) {
+            size_t end = (this->buffer_begin + this->buffer_count) % size;
+            auto part = (int64_t) std::min({size - this->buffer_count, size - end, std::max<size_t>(1, size / 2)});
+            Take(end, part);
+            lock.unlock();
+            int64_t read = this->tape->ReadBlock(this->buffer.data() + end, part);
+            lock.lock();
+
+            // Buffer could be dropped while numbers were read
+            if (this->mode == PrefetchMode::Reading) {
+                Give(end, read);
+                this->buffer_count += read;
+            }
+        } else {
+            size_t begin = this->buffer_begin;
+            auto part = (int64_t) std::min(this->buffer_count, size - begin);
+            Take(begin, part);
+            lock.unlock();
+            this->tape->WriteBlock(this->buffer.data() + begin, part);
+            lock.lock();
+
+            Give(begin, part);
+
+            this->buffer_begin = (begin + part) % size;
+            this->buffer_count -= part;
+        }
+        this->busy = false;
+        this->tape_wait.notify_all();
+    }
+}
+
+void PrefetchingTape::PushBuffer(int32_t n) {
+    this->buffer[(this->buffer_begin + this->buffer_count) % this->buffer.size()] = n;
+    this->buffer_count++;
+}
+
+int32_t PrefetchingTape::PopBuffer() {
+    int32_t n = this->buffer[this->buffer_begin];
+    this->buffer_begin = (this->buffer_begin + 1) % this->buffer.size();
+    this->buffer_count--;
+
+    return n;
+}
+
+void PrefetchingTape::Take(size_t begin, int64_t count) {
+    auto first = this->stamps.begin() + (int64_t) begin;
+    if (count > 0) {
+        Clock::Global().WaitUntil(std::chrono::microseconds(*std::max_element(first, first + count)));
+    }
+}
+
+void PrefetchingTape::Give(size_t begin, int64_t count) {
+    auto first = this->stamps.begin() + (int64_t) begin;
+    std::fill_n(first, count, Clock::Global().GetThreadTime().count());
+}
+
+PrefetchingTape::~PrefetchingTape() {
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        Drop(lock);
+        Sync(lock);
+        this->stopped = true;
+        this->worker_wait.notify_all();
+    }
+    this->worker.join();
+
+    delete this->tape;
+}
@@ -0,0 +1,92 @@
+#ifndef TEST_PREFETCHINGTAPE_H
+#define TEST_PREFETCHINGTAPE_H
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "ITape.h"
+#include "../Memory/BudgetAllocator.h"
+
+// Mode of prefetching tape, buffer is used only in one direction at once
+enum class PrefetchMode {
+    // Head of wrapped tape is under head of prefetching tape
+    Idle,
+    // Background thread read numbers after the head to buffer
+    Reading,
+    // Written numbers wait in buffer while background thread write them
+    Writing
+};
+
+// PrefetchingTape wrap any tape and hide its delays while tape is read or written in one direction
+// Background thread read ahead of the head to ring buffer, written numbers are queued to the same buffer
+// and background thread write them to wrapped tape
+// ShiftRight, Rewind and Truncate invalidate buffer: queued numbers are written, numbers that were read ahead
+// are dropped and head of wrapped tape is moved back to the head
+// Bulk reads and writes copy numbers from and to buffer, background thread move wrapped tape by blocks
+// Every cell of buffer has time of Clock when it was given to other thread: number was put to it or it was freed
+// Thread that take number or free cell from buffer move own time to that time, so modelled time of thread
+// that use tape isn't earlier than time when number was read ahead, and tape isn't written before number was queued
+// Wrapped tape is deleted by PrefetchingTape
+class PrefetchingTape: public ITape {
+public:
+    // Constructor, buffer_size - count of numbers in buffer, memory of buffer and its times is counted by account
+    PrefetchingTape(ITape* tape, int32_t buffer_size, MemoryAccount* account = nullptr);
+
+    // Copying prohibited
+    PrefetchingTape(const PrefetchingTape&) = delete;
+    PrefetchingTape& operator=(const PrefetchingTape&) = delete;
+
+    // Override methods
+    int32_t Read() override;
+    void Write(int32_t n) override;
+    void ShiftLeft() override;
+    void ShiftRight() override;
+    void Rewind() override;
+    void Truncate() override;
+    int64_t ReadBlock(int32_t* values, int64_t count) override;
+    int64_t ReadBlockBackward(int32_t* values, int64_t count) override;
+    void WriteBlock(const int32_t* values, int64_t count) override;
+
+    int64_t GetN() const override;
+    int64_t GetPosition() const override;
+    std::chrono::microseconds GetDeviceTime() const override;
+    // Counters of wrapped tape include numbers that were read ahead
+    TapeStats GetStats() const override;
+
+    ~PrefetchingTape() override;
+private:
+    ITape* tape;
+    PrefetchMode mode;
+
+    // Ring buffer of numbers after the head
+    BudgetVector<int32_t> buffer;
+    size_t buffer_begin;
+    size_t buffer_count;
+    // Time of Clock when every cell of buffer was given to other thread
+    BudgetVector<int64_t> stamps;
+
+    // Number that written under the head, it is queued when head is shifted
+    int32_t pending;
+    bool has_pending;
+
+    // Background thread work with wrapped tape
+    std::thread worker;
+    bool busy;
+    bool stopped;
+    std::mutex mutex;
+    std::condition_variable worker_wait;
+    std::condition_variable tape_wait;
+
+    void Work();
+    void Sync(std::unique_lock<std::mutex>& lock);
+    void Drop(std::unique_lock<std::mutex>& lock);
+    void PushBuffer(int32_t n);
+    int32_t PopBuffer();
+    // Wait time of cells taken from buffer and mark cells given to other thread by time of current thread
+    void Take(size_t begin, int64_t count);
+    void Give(size_t begin, int64_t count);
+};
+
+
+#endif //TEST_PREFETCHINGTAPE_H
@@ -1,10 +1,10 @@
 #include "Tape.h"
+#include "TextCodec.h"
 
-#include <fstream>
+#include <algorithm>
 #include <chrono>
-#include <thread>
-#include <vector>
-#include <iostream>
+#include <filesystem>
+#include <stdexcept>
 
 // TapeSettings constructor with settings from file
 TapeSettings::TapeSettings(const std::string& settingsFileName) {
@@ -26,6 +26,34 @@ TapeSettings::TapeSettings(const std::string& settingsFileName) {
                 settings.rewind_delay = stoi(line.substr(13));
             } else if(!line.compare(0, 11, SHIFT_DELAY_STR)) {
                 settings.shift_delay = stoi(line.substr(12));
+            } else if(!line.compare(0, 10, BLOCK_SIZE_STR)) {
+                settings.block_size = std::max(1, stoi(line.substr(11)));
+            } else if(!line.compare(0, 11, DELAY_MODEL_STR)) {
+                if (!line.compare(12, 5, DELAY_MODEL_BLOCK_STR)) {
+                    settings.delay_model = DelayModel::Block;
+                } else {
+                    settings.delay_model = DelayModel::Cell;
+                }
+            } else if(!line.compare(0, 14, TRANSFER_DELAY_STR)) {
+                settings.SetTransferDelay(stoi(line.substr(15)));
+            } else if(!line.compare(0, 17, REWIND_CELL_DELAY_STR)) {
+                settings.SetRewindCellDelay(stoi(line.substr(18)));
+            } else if(!line.compare(0, 5, CLOCK_STR)) {
+                if (!line.compare(6, 7, CLOCK_VIRTUAL_STR)) {
+                    settings.clock_mode = ClockMode::Virtual;
+                } else {
+                    settings.clock_mode = ClockMode::Real;
+                }
+            } else if(!line.compare(0, 6, FORMAT_STR)) {
+                if (!line.compare(7, 6, FORMAT_BINARY_STR)) {
+                    settings.format = TapeFormat::Binary;
+                } else if (!line.compare(7, 4, FORMAT_MMAP_STR)) {
+                    settings.format = TapeFormat::Mmap;
+                } else if (!line.compare(7, 10, FORMAT_COMPRESSED_STR)) {
+                    settings.format = TapeFormat::Compressed;
+                } else {
+                    settings.format = TapeFormat::Text;
+                }
             }
         }
 
@@ -43,6 +71,14 @@ TapeSettings::TapeSettings(int32_t read_delay, int32_t write_delay, int32_t rewi
     this->write_delay = write_delay;
     this->rewind_delay = rewind_delay;
     this->shift_delay = shift_delay;
+    this->format = TapeFormat::Text;
+    this->block_size = DEFAULT_BLOCK_SIZE;
+    this->delay_model = DelayModel::Cell;
+    this->transfer_delay = 0;
+    this->clock_mode = ClockMode::Real;
+    this->rewind_cell_delay = 0;
+    this->account = nullptr;
+    this->stats_account = nullptr;
 }
 
 int32_t TapeSettings::GetReadDelay() const {
@@ -61,6 +97,88 @@ int32_t TapeSettings::GetShiftDelay() const {
     return this->shift_delay;
 }
 
+TapeFormat TapeSettings::GetFormat() const {
+    return this->format;
+}
+
+int32_t TapeSettings::GetBlockSize() const {
+    return this->block_size;
+}
+
+DelayModel TapeSettings::GetDelayModel() const {
+    return this->delay_model;
+}
+
+int32_t TapeSettings::GetTransferDelay() const {
+    return this->transfer_delay;
+}
+
+ClockMode TapeSettings::GetClockMode() const {
+    return this->clock_mode;
+}
+
+int32_t TapeSettings::GetRewindCellDelay() const {
+    return this->rewind_cell_delay;
+}
+
+MemoryAccount *TapeSettings::GetMemoryAccount() const {
+    return this->account;
+}
+
+StatsAccount *TapeSettings::GetStatsAccount() const {
+    return this->stats_account;
+}
+
+// Cell model charge operation and shift delays for every cell, so bulk operation cost same time as cell operations
+// Block model charge them once and transfer delay for every cell
+std::chrono::microseconds TapeSettings::GetBlockDelay(int32_t operation_delay, int64_t count) const {
+    if (count <= 0) {
+        return std::chrono::microseconds(0);
+    }
+
+    std::chrono::microseconds delay = std::chrono::milliseconds(operation_delay + this->shift_delay);
+    if (this->delay_model == DelayModel::Cell) {
+        return delay * count;
+    }
+
+    return delay + std::chrono::microseconds(this->transfer_delay) * count;
+}
+
+// Long tape is rewound longer, fixed rewind delay is waited even if head is in the start
+std::chrono::microseconds TapeSettings::GetRewindTime(int64_t position) const {
+    return std::chrono::milliseconds(this->rewind_delay) + std::chrono::microseconds(this->rewind_cell_delay) * position;
+}
+
+void TapeSettings::SetBlockSize(int32_t block_size) {
+    this->block_size = std::max(1, block_size);
+}
+
+void TapeSettings::SetMemoryAccount(MemoryAccount *account) {
+    this->account = account;
+}
+
+void TapeSettings::SetStatsAccount(StatsAccount *stats_account) {
+    this->stats_account = stats_account;
+}
+
+void TapeSettings::SetDelayModel(DelayModel delay_model) {
+    this->delay_model = delay_model;
+}
+
+void TapeSettings::SetTransferDelay(int32_t transfer_delay) {
+    this->transfer_delay = std::max(0, transfer_delay);
+}
+
+void TapeSettings::SetClockMode(ClockMode clock_mode) {
+    this->clock_mode = clock_mode;
+}
+
+void TapeSettings::SetRewindCellDelay(int32_t rewind_cell_delay) {
+    this->rewind_cell_delay = std::max(0, rewind_cell_delay);
+}
+
+TapeSettings::TapeSettings(TapeSettings const &other) = default;
+
 TapeSettings &TapeSettings::operator=(TapeSettings const &other) = default;
 
 TapeSettings::TapeSettings()
@@ -69,153 +187,460 @@ TapeSettings::TapeSettings()
     this->write_delay = 0;
     this->shift_delay = 0;
     this->rewind_delay = 0;
+    this->format = TapeFormat::Text;
+    this->block_size = DEFAULT_BLOCK_SIZE;
+    this->delay_model = DelayModel::Cell;
+    this->transfer_delay = 0;
+    this->clock_mode = ClockMode::Real;
+    this->rewind_cell_delay = 0;
+    this->account = nullptr;
+    this->stats_account = nullptr;
 };
 
 TapeSettings::~TapeSettings() = default;
 
-// Tape constructor
-Tape::Tape(const std::string& inputFileName, TapeSettings& settings) {
+// BlockTape constructor
+BlockTape::BlockTape(const std::string& inputFileName, TapeSettings& settings, bool unbuffered) {
     // Copy fields
+    this->N = 0;
     this->position = 0;
     this->file = inputFileName;
     this->settings = settings;
+    this->timer.SetMode(settings.GetClockMode());
 
-    // Calculate N
-    this->N = CalculateN(inputFileName);
-}
-
-int64_t Tape::CalculateN(const std::string& inputFileName) const {
-    std::ifstream tape_file;
-    tape_file.open(inputFileName);
-    if (tape_file.is_open()) {
-        int32_t value;
-        int64_t i = 0;
-
-        // If file is empty N=0
-        if(tape_file.peek() == std::ifstream::traits_type::eof()) {
-            tape_file.close();
-            return 0;
-        }
-
-        // Just count all numbers in file
-        do {
-            tape_file >> value;
-            i++;
-        } while(!tape_file.eof());
+    // No block loaded yet, its memory is counted by account from settings
+    this->block = BudgetVector<int32_t>(BudgetAllocator<int32_t>(settings.GetMemoryAccount()));
+    this->block_index = -1;
+    this->dirty = false;
 
-        tape_file.close();
-        return i;
+    // Create file if it doesn't exist, fstream can't open missing file for reading and writing
+    if (!std::filesystem::exists(inputFileName)) {
+        std::ofstream create(inputFileName, std::ios::binary);
+        create.close();
+    }
+    if (unbuffered) {
+        this->stream.rdbuf()->pubsetbuf(nullptr, 0);
+    }
+    // Binary mode keeps byte offsets equal to positions in file
+    this->stream.open(inputFileName, std::ios::in | std::ios::out | std::ios::binary);
+    // Read-only file still can be read as input tape
+    if (!this->stream.is_open()) {
+        this->stream.clear();
+        this->stream.open(inputFileName, std::ios::in | std::ios::binary);
+    }
+    if (!this->stream.is_open()) {
+        throw std::runtime_error("Can't open tape file " + inputFileName);
     }
-
-    return 0;
 }
 
-void Tape::Write(int32_t n) {
+void BlockTape::Write(int32_t n) {
     // Wait delay
-    std::this_thread::sleep_for(std::chrono::milliseconds(this->settings.GetWriteDelay()));
+    this->timer.Wait(std::chrono::milliseconds(this->settings.GetWriteDelay()));
+    this->stats.writes++;
+
+    LoadBlock(this->GetPosition() / this->settings.GetBlockSize());
 
-    // If current position == N then we in the end of the tape, so we should use append method
+    // Cell under head can be changed in place, if head in the end of the tape it's append
+    int64_t cell = this->GetPosition() - this->block_index * this->settings.GetBlockSize();
     if (this->GetPosition() < this->GetN()) {
-        ChangeNumber(n);
+        this->block[cell] = n;
     } else {
-        Append(n);
-    }
-}
-
-// Method that change number in file
-void Tape::ChangeNumber(int32_t n) const {
-    // Open tape file
-    std::ifstream tape_file(this->GetFileName());
-    if (tape_file.is_open()) {
-        std::vector<int32_t> tape;
-        int32_t value;
-        // Read all numbers in file and push it to vector.
-        // Number that is under head changed to n
-        for (int i = 0; tape_file >> value; i++) {
-            if (i == this->GetPosition()) {
-                tape.push_back(n);
-            } else {
-                tape.push_back(value);
-            }
-        }
-        tape_file.close();
+        this->block.push_back(n);
+        this->N++;
+    }
+    this->dirty = true;
+}
 
-        // Open file for write and write vector
-        std::ofstream changed_file(this->GetFileName());
-        for (auto num: tape) {
-            changed_file << " " << num;
-        }
-        changed_file.close();
+int32_t BlockTape::Read() {
+    // Wait delay
+    this->timer.Wait(std::chrono::milliseconds(this->settings.GetReadDelay()));
+    this->stats.reads++;
+
+    if (this->GetN() == 0) {
+        return 0;
     }
+
+    // Head in the end of the tape see the last number
+    int64_t cell = std::min(this->GetPosition(), this->GetN() - 1);
+    LoadBlock(cell / this->settings.GetBlockSize());
+
+    return this->block[cell - this->block_index * this->settings.GetBlockSize()];
 }
 
-// Method that append number to the end of the tape include case of empty tape
-void Tape::Append(int32_t n) {
-    std::ofstream tape_file(this->GetFileName(), std::ios::app);
-    if (tape_file.is_open()) {
-        // Can't start file of tape with space
-        if (this->GetPosition() != 0) {
-            tape_file << " " << n;
-        } else {
-            tape_file << n;
-        }
+// Read numbers block by block, delay is counted for the whole operation
+int64_t BlockTape::ReadBlock(int32_t *values, int64_t count) {
+    count = std::max<int64_t>(0, std::min(count, this->GetN() - this->GetPosition()));
+    this->timer.Wait(this->settings.GetBlockDelay(this->settings.GetReadDelay(), count));
+    this->stats.reads += count;
+    this->stats.shifts_left += count;
+
+    int64_t size = this->settings.GetBlockSize();
+    for (int64_t i = 0; i < count;) {
+        LoadBlock(this->GetPosition() / size);
+
+        int64_t cell = this->GetPosition() - this->block_index * size;
+        int64_t n = std::min(count - i, (int64_t) this->block.size() - cell);
+        std::copy(this->block.begin() + cell, this->block.begin() + cell + n, values + i);
+
+        i += n;
+        this->position += n;
     }
-    tape_file.close();
-    // Add new number, so n increment
-    this->N++;
+
+    return count;
 }
 
-int32_t Tape::Read() {
-    // Wait delay
-    std::this_thread::sleep_for(std::chrono::milliseconds(this->settings.GetReadDelay()));
+// Read numbers before the head block by block from right to left
+int64_t BlockTape::ReadBlockBackward(int32_t *values, int64_t count) {
+    count = std::max<int64_t>(0, std::min(count, this->GetPosition()));
+    this->timer.Wait(this->settings.GetBlockDelay(this->settings.GetReadDelay(), count));
+    this->stats.reads += count;
+    this->stats.shifts_right += count;
+
+    int64_t size = this->settings.GetBlockSize();
+    for (int64_t i = 0; i < count;) {
+        LoadBlock((this->GetPosition() - 1) / size);
 
-    // Open tape file
-    std::ifstream tape_file;
-    tape_file.open(this->GetFileName());
-    if (tape_file.is_open()) {
-        // Skip numbers to the position of the head and return number that stay under head
-        int32_t value;
-        for (int i = 0; i <= this->GetPosition(); i++, tape_file >> value) {}
+        int64_t cell = this->GetPosition() - this->block_index * size;
+        int64_t n = std::min(count - i, cell);
+        std::reverse_copy(this->block.begin() + cell - n, this->block.begin() + cell, values + i);
 
-        tape_file.close();
-        return value;
+        i += n;
+        this->position -= n;
     }
 
-    return 0;
+    return count;
 }
 
-void Tape::ShiftLeft() {
+// Write numbers block by block, numbers after the end of tape are appended
+void BlockTape::WriteBlock(const int32_t *values, int64_t count) {
+    this->timer.Wait(this->settings.GetBlockDelay(this->settings.GetWriteDelay(), count));
+    this->stats.writes += count;
+    this->stats.shifts_left += count;
+
+    int64_t size = this->settings.GetBlockSize();
+    for (int64_t i = 0; i < count;) {
+        LoadBlock(this->GetPosition() / size);
+
+        int64_t cell = this->GetPosition() - this->block_index * size;
+        int64_t n = std::min(count - i, size - cell);
+        for (int64_t j = 0; j < n; j++) {
+            if (cell + j < (int64_t) this->block.size()) {
+                this->block[cell + j] = values[i + j];
+            } else {
+                this->block.push_back(values[i + j]);
+                this->N++;
+            }
+        }
+        this->dirty = true;
+
+        i += n;
+        this->position += n;
+    }
+}
+
+void BlockTape::ShiftLeft() {
     // Cant shift to left if position==N
     if (this->GetPosition() < this->GetN()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(this->settings.GetShiftDelay()));
+        this->timer.Wait(std::chrono::milliseconds(this->settings.GetShiftDelay()));
+        this->stats.shifts_left++;
         this->position++;
     }
 }
 
-void Tape::ShiftRight() {
+void BlockTape::ShiftRight() {
     // Cant shift to right if position==0
     if (this->GetPosition() > 0) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(this->settings.GetShiftDelay()));
+        this->timer.Wait(std::chrono::milliseconds(this->settings.GetShiftDelay()));
+        this->stats.shifts_right++;
         this->position--;
     }
 }
 
-void Tape::Rewind() {
-    std::this_thread::sleep_for(std::chrono::milliseconds(this->settings.GetRewindDelay()));
+void BlockTape::Rewind() {
+    this->timer.Wait(this->settings.GetRewindTime(this->GetPosition()));
+    this->stats.rewinds++;
 
+    FlushBlock();
     this->position = 0;
 }
 
-int64_t Tape::GetN() const {
+int64_t BlockTape::GetN() const {
     return this->N;
 }
 
-int64_t Tape::GetPosition() const {
+int64_t BlockTape::GetPosition() const {
     return this->position;
 }
 
-std::string Tape::GetFileName() const {
+std::chrono::microseconds BlockTape::GetDeviceTime() const {
+    return this->timer.GetDeviceTime();
+}
+
+TapeStats BlockTape::GetStats() const {
+    TapeStats stats = this->stats;
+    stats.delay = this->timer.GetDeviceTime().count();
+
+    return stats;
+}
+
+std::string BlockTape::GetFileName() const {
     return this->file;
 }
 
-Tape::~Tape() = default;
\ No newline at end of file
+BlockTape::~BlockTape() {
+    this->stream.close();
+
+    if (this->settings.GetStatsAccount() != nullptr) {
+        this->settings.GetStatsAccount()->Add(GetStats());
+    }
+}
+
+// Tape constructor
+Tape::Tape(const std::string& inputFileName, TapeSettings& settings)
+        : BlockTape(inputFileName, settings, false) {
+    this->block_begin = 0;
+    this->block_end = 0;
+
+    // Calculate N
+    this->N = CalculateN();
+}
+
+// Index of checkpoints is built while numbers are counted
+int64_t Tape::CalculateN() {
+    this->file_size = 0;
+    this->index.assign(1, 0);
+
+    if (!this->stream.is_open()) {
+        return 0;
+    }
+
+    this->stream.seekg(0, std::ios::end);
+    this->file_size = this->stream.tellg();
+
+    // If file is empty N=0
+    if (this->file_size == 0) {
+        return 0;
+    }
+
+    // Just count all numbers in file
+    TextReader reader(this->stream, 0, TEXT_BUFFER_SIZE);
+    int32_t value;
+    int64_t i = 0;
+    while (reader.Next(value)) {
+        i++;
+        if (i % INDEX_STRIDE == 0) {
+            this->index.push_back(reader.GetOffset());
+        }
+    }
+
+    this->stats.bytes_read += this->file_size;
+    this->stats.syscalls++;
+
+    return i;
+}
+
+// Skip count numbers starting from offset and return offset after the last skipped number
+int64_t Tape::SkipCells(int64_t offset, int64_t count) {
+    if (count == 0) {
+        return offset;
+    }
+
+    TextReader reader(this->stream, offset, MOVE_BUFFER_SIZE);
+    int32_t value;
+    for (int64_t i = 0; i < count && reader.Next(value); i++) {}
+
+    int64_t end = reader.GetOffset();
+    this->stats.bytes_read += end - offset;
+    this->stats.syscalls++;
+
+    return end;
+}
+
+// Offset from which cell is parsed
+// Parsing start from the nearest checkpoint before the cell or from loaded block if it's nearer
+// Block should be flushed, so offsets of checkpoints and block are actual
+int64_t Tape::FindOffset(int64_t cell) {
+    int64_t j = std::min(cell / INDEX_STRIDE, (int64_t) this->index.size() - 1);
+    int64_t from = j * INDEX_STRIDE;
+    int64_t offset = this->index[j];
+
+    if (this->block_index >= 0) {
+        int64_t first = this->block_index * this->settings.GetBlockSize();
+        int64_t end = first + (int64_t) this->block.size();
+        if (end <= cell && end > from) {
+            from = end;
+            offset = this->block_end;
+        } else if (first <= cell && first > from) {
+            from = first;
+            offset = this->block_begin;
+        }
+    }
+
+    return SkipCells(offset, cell - from);
+}
+
+// Set checkpoint j, checkpoints are added in order when tape grow
+void Tape::UpdateIndex(int64_t j, int64_t offset) {
+    if (j < (int64_t) this->index.size()) {
+        this->index[j] = offset;
+    } else if (j == (int64_t) this->index.size()) {
+        this->index.push_back(offset);
+    }
+}
+
+// Load block with index to memory, current block is flushed before
+void Tape::LoadBlock(int64_t index) {
+    if (index == this->block_index) {
+        return;
+    }
+
+    FlushBlock();
+
+    int64_t size = this->settings.GetBlockSize();
+    int64_t first = index * size;
+
+    // Find offset of the block
+    int64_t begin = FindOffset(first);
+
+    // Read numbers of the block
+    int64_t count = std::min(size, this->GetN() - first);
+    this->block.clear();
+    this->block.reserve(size);
+    TextReader reader(this->stream, begin, MOVE_BUFFER_SIZE);
+    int32_t value;
+    for (int64_t i = 0; i < count && reader.Next(value); i++) {
+        this->block.push_back(value);
+    }
+
+    this->block_index = index;
+    this->block_begin = begin;
+    this->block_end = count > 0 ? reader.GetOffset() : begin;
+
+    if (count > 0) {
+        this->stats.bytes_read += this->block_end - begin;
+        this->stats.syscalls++;
+    }
+}
+
+// Write changed block back to file
+void Tape::FlushBlock() {
+    if (!this->dirty) {
+        return;
+    }
+
+    // Numbers are separated by space, file can't start with space
+    int64_t first = this->block_index * this->settings.GetBlockSize();
+    int64_t length = 0;
+    for (size_t i = 0; i < this->block.size(); i++) {
+        length += CellLength(this->block[i]) + (first + (int64_t) i > 0 ? 1 : 0);
+    }
+
+    // If new numbers are shorter, fill the rest with spaces, so block is changed in place
+    // If they are longer, move part of file after the block to get free place
+    int64_t size = this->block_end - this->block_begin;
+    if (length > size) {
+        MoveTail(this->block_end, length - size);
+        this->block_end += length - size;
+    }
+
+    // Numbers are formatted to small buffer that is written when it's full, so block doesn't need memory for text
+    // Checkpoints inside the block are moved to new offsets, new checkpoints are added for appended numbers
+    std::vector<char> text(MOVE_BUFFER_SIZE);
+    size_t used = 0;
+    int64_t offset = this->block_begin;
+    this->stream.seekp(this->block_begin);
+    for (size_t i = 0; i < this->block.size(); i++) {
+        if (used + MAX_CELL_LENGTH + 1 > text.size()) {
+            this->stream.write(text.data(), (std::streamsize) used);
+            offset += (int64_t) used;
+            used = 0;
+        }
+
+        int64_t cell = first + (int64_t) i;
+        if (cell % INDEX_STRIDE == 0) {
+            UpdateIndex(cell / INDEX_STRIDE, offset + (int64_t) used);
+        }
+        if (cell > 0) {
+            text[used++] = ' ';
+        }
+        used = FormatCell(this->block[i], text.data() + used) - text.data();
+    }
+    for (int64_t i = length; i < size; i++) {
+        if (used == text.size()) {
+            this->stream.write(text.data(), (std::streamsize) used);
+            used = 0;
+        }
+        text[used++] = ' ';
+    }
+    this->stream.write(text.data(), (std::streamsize) used);
+    this->stream.flush();
+
+    this->stats.bytes_written += std::max(length, size);
+    this->stats.syscalls++;
+
+    this->dirty = false;
+}
+
+// Count of chars that number take in file
+int64_t Tape::CellLength(int32_t n) {
+    int64_t length = n < 0 ? 2 : 1;
+    for (int64_t value = n < 0 ? -(int64_t) n : n; value >= 10; value /= 10) {
+        length++;
+    }
+    return length;
+}
+
+// Move part of file after offset by delta bytes, checkpoints of moved part are moved too
+void Tape::MoveTail(int64_t offset, int64_t delta) {
+    std::vector<char> buffer(MOVE_BUFFER_SIZE);
+
+    int64_t end = this->file_size;
+    while (end > offset) {
+        int64_t begin = std::max(offset, end - (int64_t) buffer.size());
+
+        this->stream.seekg(begin);
+        this->stream.read(buffer.data(), end - begin);
+        this->stream.seekp(begin + delta);
+        this->stream.write(buffer.data(), end - begin);
+
+        this->stats.bytes_read += end - begin;
+        this->stats.bytes_written += end - begin;
+        this->stats.syscalls += 2;
+
+        end = begin;
+    }
+
+    this->file_size += delta;
+
+    for (auto& checkpoint: this->index) {
+        if (checkpoint >= offset) {
+            checkpoint += delta;
+        }
+    }
+}
+
+// Cut the tape after the head, so tape can be written again from the head position
+void Tape::Truncate() {
+    if (this->GetPosition() >= this->GetN()) {
+        return;
+    }
+
+    FlushBlock();
+
+    // Find end of the last number before the head
+    int64_t end = FindOffset(this->GetPosition());
+
+    this->stream.flush();
+    std::filesystem::resize_file(this->file, end);
+    this->stats.syscalls++;
+    this->file_size = end;
+    this->N = this->GetPosition();
+    this->index.resize(this->GetN() / INDEX_STRIDE + 1);
+
+    // Block is loaded again on next access
+    this->block_index = -1;
+}
+
+Tape::~Tape() {
+    FlushBlock();
+}
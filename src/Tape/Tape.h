@@ -3,14 +3,68 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
 
 #include "ITape.h"
+#include "Clock.h"
+#include "../Memory/MemoryAccount.h"
+#include "../Memory/BudgetAllocator.h"
 
 // Define strings of settings.txt file that used for tape settings
 #define READ_DELAY_STR "READ_DELAY"
 #define WRITE_DELAY_STR "WRITE_DELAY"
 #define SHIFT_DELAY_STR "SHIFT_DELAY"
 #define REWIND_DELAY_STR "REWIND_DELAY"
+#define FORMAT_STR "FORMAT"
+#define BLOCK_SIZE_STR "BLOCK_SIZE"
+#define DELAY_MODEL_STR "DELAY_MODEL"
+#define TRANSFER_DELAY_STR "TRANSFER_DELAY"
+#define CLOCK_STR "CLOCK"
+#define REWIND_CELL_DELAY_STR "REWIND_CELL_DELAY"
+
+// Count of cells that tape keep in memory around the head if BLOCK_SIZE not set
+#define DEFAULT_BLOCK_SIZE 1024
+// Size of buffer in bytes that used to parse, write and move parts of text file
+// Buffer live only during one operation and its size doesn't depend on memory limit, so it isn't counted by account
+#define MOVE_BUFFER_SIZE 4096
+// Text tape remember offset of every INDEX_STRIDE-th cell, so cell is found by parsing at most INDEX_STRIDE cells
+#define INDEX_STRIDE 4096
+
+// Define values of FORMAT setting
+#define FORMAT_TEXT_STR "TEXT"
+#define FORMAT_BINARY_STR "BINARY"
+#define FORMAT_MMAP_STR "MMAP"
+#define FORMAT_COMPRESSED_STR "COMPRESSED"
+
+// Define values of DELAY_MODEL setting
+#define DELAY_MODEL_CELL_STR "CELL"
+#define DELAY_MODEL_BLOCK_STR "BLOCK"
+
+// Define values of CLOCK setting
+#define CLOCK_REAL_STR "REAL"
+#define CLOCK_VIRTUAL_STR "VIRTUAL"
+
+// Format of file that store tape cells
+enum class TapeFormat {
+    // Space separated numbers, used for input and output tapes
+    Text,
+    // Fixed width little-endian int32 cells
+    Binary,
+    // Same file as Binary, but accessed through memory mapping
+    Mmap,
+    // Every block is stored as frame of delta encoded numbers, used for temp tapes with sorted runs
+    Compressed
+};
+
+// Way to count delay of bulk read and write
+enum class DelayModel {
+    // Every cell wait read or write delay and shift delay as if it was moved alone
+    Cell,
+    // Block wait read or write delay and shift delay once and transfer delay for every cell
+    Block
+};
 
 // TapeSettings define tape characteristics as is read, write, shift and rewind delays
 class TapeSettings {
@@ -20,7 +74,8 @@ public:
     TapeSettings(int32_t read_delay, int32_t write_delay, int32_t rewind_delay, int32_t shift_delay);
     TapeSettings();
 
-    // Copy operator
+    // Copy constructor and operator
+    TapeSettings(TapeSettings const& other);
     TapeSettings& operator=(TapeSettings const& other);
 
     // Getters
@@ -28,6 +83,29 @@ public:
     int32_t GetWriteDelay() const;
     int32_t GetRewindDelay() const;
     int32_t GetShiftDelay() const;
+    TapeFormat GetFormat() const;
+    int32_t GetBlockSize() const;
+    DelayModel GetDelayModel() const;
+    int32_t GetTransferDelay() const;
+    ClockMode GetClockMode() const;
+    int32_t GetRewindCellDelay() const;
+
+    MemoryAccount* GetMemoryAccount() const;
+    StatsAccount* GetStatsAccount() const;
+
+    // Delay of bulk operation with count cells
+    std::chrono::microseconds GetBlockDelay(int32_t operation_delay, int64_t count) const;
+    // Delay of rewind from position to the start of tape
+    std::chrono::microseconds GetRewindTime(int64_t position) const;
+
+    // Setters
+    void SetBlockSize(int32_t block_size);
+    void SetMemoryAccount(MemoryAccount* account);
+    void SetStatsAccount(StatsAccount* stats_account);
+    void SetDelayModel(DelayModel delay_model);
+    void SetTransferDelay(int32_t transfer_delay);
+    void SetClockMode(ClockMode clock_mode);
+    void SetRewindCellDelay(int32_t rewind_cell_delay);
 
     // Destructor
     ~TapeSettings();
@@ -36,39 +114,105 @@ private:
     int32_t write_delay;
     int32_t rewind_delay;
     int32_t shift_delay;
+    TapeFormat format;
+    int32_t block_size;
+    DelayModel delay_model;
+    // Delay of one cell in bulk operation in microseconds, it's used by block delay model
+    int32_t transfer_delay;
+    ClockMode clock_mode;
+    // Rewind wait rewind delay and this delay in microseconds for every cell between the head and the start
+    int32_t rewind_cell_delay;
+    // Account that count memory of tape blocks, nullptr if memory isn't counted
+    MemoryAccount* account;
+    // Account that sum counters of tapes when they are deleted, nullptr if counters aren't summed
+    StatsAccount* stats_account;
 };
 
-// Tape is a class that implement ITape and emulate work with tape
-class Tape: public ITape {
+// BlockTape is a base of tapes that keep one block of cells around the head in memory
+// It move the head, count delays and counters and copy cells between block and caller
+// Subclasses only load and flush block in format of their file and cut the file
+class BlockTape: public ITape {
 public:
-    // Constructor
-    Tape(const std::string& inputFileName, TapeSettings& settings);
-
     // Methods to work with tape
     int32_t Read() override;
     void Write(int32_t n) override;
     void ShiftLeft() override;
     void ShiftRight() override;
     void Rewind() override;
+    int64_t ReadBlock(int32_t* values, int64_t count) override;
+    int64_t ReadBlockBackward(int32_t* values, int64_t count) override;
+    void WriteBlock(const int32_t* values, int64_t count) override;
 
     // Some getters
     std::string GetFileName() const;
     int64_t GetN() const override;
     int64_t GetPosition() const override;
+    std::chrono::microseconds GetDeviceTime() const override;
+    TapeStats GetStats() const override;
+
+    // Override destructor, subclass should flush block in its destructor
+    ~BlockTape() override;
+protected:
+    // Constructor open file, it's created if it doesn't exist
+    // Unbuffered stream read and write every block by one call to file
+    BlockTape(const std::string& inputFileName, TapeSettings& settings, bool unbuffered);
+
+    TapeSettings settings;
+    DeviceTimer timer;
+    TapeStats stats;
+    std::string file;
+    // File stay opened while tape exist
+    std::fstream stream;
+
+    // Block of cells around the head
+    // Block k contain cells [k*BLOCK_SIZE, (k+1)*BLOCK_SIZE)
+    BudgetVector<int32_t> block;
+    int64_t block_index;
+    // Block was changed and should be written to file
+    bool dirty;
+
+    // Load block with index to memory, current block is flushed before
+    virtual void LoadBlock(int64_t index) = 0;
+    // Write changed block back to file
+    virtual void FlushBlock() = 0;
+
+    // Copying prohibited
+    BlockTape() = default;
+};
+
+// Tape is a class that implement ITape and emulate work with tape
+// File is text of space separated numbers
+class Tape: public BlockTape {
+public:
+    // Constructor
+    Tape(const std::string& inputFileName, TapeSettings& settings);
+
+    void Truncate() override;
 
     // Override destructor
     ~Tape() override;
 private:
 
-    TapeSettings settings;
-    std::string file;
+    // Block take bytes [block_begin, block_end) of file
+    int64_t block_begin;
+    int64_t block_end;
+    // Size of file in bytes
+    int64_t file_size;
+    // Sparse index, index[j] is offset from which cell j*INDEX_STRIDE is parsed
+    // It takes 8 bytes for INDEX_STRIDE cells, so it isn't counted by memory account
+    std::vector<int64_t> index;
 
     // Calculate N when calling constructor
-    int64_t CalculateN(const std::string& inputFileName) const;
-
-    // Methods for writing
-    void ChangeNumber(int32_t n) const;
-    void Append(int32_t n);
+    int64_t CalculateN();
+
+    // Methods for work with block
+    void LoadBlock(int64_t index) override;
+    void FlushBlock() override;
+    int64_t SkipCells(int64_t offset, int64_t count);
+    int64_t FindOffset(int64_t cell);
+    void UpdateIndex(int64_t j, int64_t offset);
+    void MoveTail(int64_t offset, int64_t delta);
+    static int64_t CellLength(int32_t n);
 
     // Copying prohibited
     Tape() = default;
@@ -0,0 +1,77 @@
+#include "TapeStats.h"
+
+#include <sstream>
+
+TapeStats::TapeStats() {
+    this->reads = 0;
+    this->writes = 0;
+    this->shifts_left = 0;
+    this->shifts_right = 0;
+    this->rewinds = 0;
+    this->bytes_read = 0;
+    this->bytes_written = 0;
+    this->syscalls = 0;
+    this->delay = 0;
+}
+
+TapeStats& TapeStats::operator+=(const TapeStats& other) {
+    this->reads += other.reads;
+    this->writes += other.writes;
+    this->shifts_left += other.shifts_left;
+    this->shifts_right += other.shifts_right;
+    this->rewinds += other.rewinds;
+    this->bytes_read += other.bytes_read;
+    this->bytes_written += other.bytes_written;
+    this->syscalls += other.syscalls;
+    this->delay += other.delay;
+
+    return *this;
+}
+
+std::string TapeStats::ToJson() const {
+    std::stringstream json;
+
+    json << "{\"reads\": " << this->reads
+         << ", \"writes\": " << this->writes
+         << ", \"shifts_left\": " << this->shifts_left
+         << ", \"shifts_right\": " << this->shifts_right
+         << ", \"rewinds\": " << this->rewinds
+         << ", \"bytes_read\": " << this->bytes_read
+         << ", \"bytes_written\": " << this->bytes_written
+         << ", \"syscalls\": " << this->syscalls
+         << ", \"delay_us\": " << this->delay << "}";
+
+    return json.str();
+}
+
+StatsAccount::StatsAccount() {
+    this->tapes = 0;
+}
+
+void StatsAccount::Add(const TapeStats& stats) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->total += stats;
+    this->tapes++;
+}
+
+void StatsAccount::Reset() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->total = TapeStats();
+    this->tapes = 0;
+}
+
+TapeStats StatsAccount::GetTotal() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    return this->total;
+}
+
+int64_t StatsAccount::GetTapes() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    return this->tapes;
+}
+
+StatsAccount::~StatsAccount() = default;
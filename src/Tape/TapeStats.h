@@ -0,0 +1,59 @@
+#ifndef TEST_TAPESTATS_H
+#define TEST_TAPESTATS_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Counters of tape work, they are used to see where sort spend time
+struct TapeStats {
+    // Count of read and written cells, bulk operation count every cell
+    int64_t reads;
+    int64_t writes;
+    // Count of cells that head was moved in every direction
+    int64_t shifts_left;
+    int64_t shifts_right;
+    int64_t rewinds;
+    // Bytes that tape moved between file and memory
+    int64_t bytes_read;
+    int64_t bytes_written;
+    // Count of calls to file system: reads, writes, seeks of file and mapping calls
+    int64_t syscalls;
+    // Time of delays that tape waited in microseconds
+    int64_t delay;
+
+    TapeStats();
+
+    TapeStats& operator+=(const TapeStats& other);
+
+    // Counters as JSON object
+    std::string ToJson() const;
+};
+
+// StatsAccount sum counters of several tapes, tape add its counters when it's deleted
+// Methods are thread safe, so one account can be shared by several threads
+class StatsAccount {
+public:
+    StatsAccount();
+
+    // Copying prohibited
+    StatsAccount(const StatsAccount&) = delete;
+    StatsAccount& operator=(const StatsAccount&) = delete;
+
+    void Add(const TapeStats& stats);
+    void Reset();
+
+    // Getters
+    TapeStats GetTotal() const;
+    int64_t GetTapes() const;
+
+    ~StatsAccount();
+private:
+    mutable std::mutex mutex;
+    TapeStats total;
+    // Count of tapes that added counters
+    int64_t tapes;
+};
+
+
+#endif //TEST_TAPESTATS_H
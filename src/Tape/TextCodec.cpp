@@ -0,0 +1,131 @@
+#include "TextCodec.h"
+#include "BinaryTape.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+
+TextReader::TextReader(std::istream& stream, int64_t offset, size_t buffer_size) : stream(stream) {
+    this->buffer.resize(std::max<size_t>(buffer_size, MAX_CELL_LENGTH + 1));
+    this->begin = 0;
+    this->end = 0;
+    this->buffer_offset = offset;
+    this->eof = false;
+
+    this->stream.clear();
+    this->stream.seekg(offset);
+}
+
+// Chars that weren't parsed are moved to the start of buffer and buffer is filled after them
+bool TextReader::Fill() {
+    if (this->eof) {
+        return false;
+    }
+
+    std::copy(this->buffer.begin() + (long) this->begin, this->buffer.begin() + (long) this->end, this->buffer.begin());
+    this->buffer_offset += (int64_t) this->begin;
+    this->end -= this->begin;
+    this->begin = 0;
+
+    size_t requested = this->buffer.size() - this->end;
+    this->stream.read(this->buffer.data() + this->end, (std::streamsize) requested);
+    auto count = (size_t) this->stream.gcount();
+    this->end += count;
+
+    // Stream can be used again after the end of file was reached
+    if (count < requested) {
+        this->eof = true;
+        this->stream.clear();
+    }
+
+    return count > 0;
+}
+
+bool TextReader::Next(int32_t& value) {
+    // Skip spaces and line breaks
+    while (true) {
+        while (this->begin < this->end && (this->buffer[this->begin] == ' ' || this->buffer[this->begin] == '\n' ||
+                                           this->buffer[this->begin] == '\r' || this->buffer[this->begin] == '\t')) {
+            this->begin++;
+        }
+        if (this->begin < this->end) {
+            break;
+        }
+        if (!Fill()) {
+            return false;
+        }
+    }
+
+    // Number is parsed only if it's whole in buffer
+    if (this->end - this->begin <= MAX_CELL_LENGTH) {
+        Fill();
+    }
+
+    auto result = std::from_chars(this->buffer.data() + this->begin, this->buffer.data() + this->end, value);
+    if (result.ec != std::errc()) {
+        return false;
+    }
+    this->begin = result.ptr - this->buffer.data();
+
+    return true;
+}
+
+int64_t TextReader::GetOffset() const {
+    return this->buffer_offset + (int64_t) this->begin;
+}
+
+TextReader::~TextReader() = default;
+
+char* FormatCell(int32_t n, char* text) {
+    return std::to_chars(text, text + MAX_CELL_LENGTH, n).ptr;
+}
+
+int64_t ImportTextFile(const std::string& text_file, const std::string& binary_file) {
+    std::ifstream input(text_file, std::ios::binary);
+    std::ofstream output(binary_file, std::ios::binary | std::ios::trunc);
+
+    TextReader reader(input, 0, TEXT_BUFFER_SIZE);
+    std::vector<char> buffer(TEXT_BUFFER_SIZE);
+    size_t used = 0;
+    int64_t count = 0;
+    int32_t value;
+    while (reader.Next(value)) {
+        if (used + CELL_SIZE > buffer.size()) {
+            output.write(buffer.data(), (std::streamsize) used);
+            used = 0;
+        }
+        BinaryTape::EncodeCell(value, buffer.data() + used);
+        used += CELL_SIZE;
+        count++;
+    }
+    output.write(buffer.data(), (std::streamsize) used);
+
+    return count;
+}
+
+int64_t ExportTextFile(const std::string& binary_file, const std::string& text_file) {
+    std::ifstream input(binary_file, std::ios::binary);
+    std::ofstream output(text_file, std::ios::binary | std::ios::trunc);
+
+    std::vector<char> cells(TEXT_BUFFER_SIZE);
+    std::vector<char> text(TEXT_BUFFER_SIZE);
+    size_t used = 0;
+    int64_t count = 0;
+    while (input.read(cells.data(), (std::streamsize) cells.size()) || input.gcount() > 0) {
+        auto read = (size_t) input.gcount();
+        for (size_t i = 0; i + CELL_SIZE <= read; i += CELL_SIZE) {
+            if (used + MAX_CELL_LENGTH + 1 > text.size()) {
+                output.write(text.data(), (std::streamsize) used);
+                used = 0;
+            }
+            if (count > 0) {
+                text[used++] = ' ';
+            }
+            used = FormatCell(BinaryTape::DecodeCell(cells.data() + i), text.data() + used) - text.data();
+            count++;
+        }
+    }
+    output.write(text.data(), (std::streamsize) used);
+
+    return count;
+}
@@ -0,0 +1,56 @@
+#ifndef TEST_TEXTCODEC_H
+#define TEST_TEXTCODEC_H
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+// Size of buffer in bytes that used by import and export of text files
+#define TEXT_BUFFER_SIZE (1 << 16)
+// The longest number in text: sign and 10 digits
+#define MAX_CELL_LENGTH 11
+
+// TextReader parse space separated numbers by std::from_chars, it doesn't depend on locale as operator>> do
+// Stream is read by calls of buffer size, number that isn't read to the end is moved to the start of buffer
+// and the rest of it is read by the next call
+// Reader is created for one operation of tape or for import of text file, its buffer isn't counted by memory account
+class TextReader {
+public:
+    // Constructor, numbers are parsed from offset of stream
+    TextReader(std::istream& stream, int64_t offset, size_t buffer_size);
+
+    // Copying prohibited
+    TextReader(const TextReader&) = delete;
+    TextReader& operator=(const TextReader&) = delete;
+
+    // Parse next number, return false in the end of stream or if there is no number
+    bool Next(int32_t& value);
+    // Offset of stream after the last parsed number
+    int64_t GetOffset() const;
+
+    ~TextReader();
+private:
+    std::istream& stream;
+    std::vector<char> buffer;
+    // Not parsed chars of buffer
+    size_t begin;
+    size_t end;
+    // Offset of stream of the first char of buffer
+    int64_t buffer_offset;
+    bool eof;
+
+    bool Fill();
+};
+
+// Write number as text by std::to_chars, text should have place for MAX_CELL_LENGTH chars
+// Return pointer after the last written char
+char* FormatCell(int32_t n, char* text);
+
+// Convert space separated text file to binary tape file and back, return count of numbers
+// Files are read and written by TEXT_BUFFER_SIZE bytes, it's done before and after sort, so buffers aren't counted
+int64_t ImportTextFile(const std::string& text_file, const std::string& binary_file);
+int64_t ExportTextFile(const std::string& binary_file, const std::string& text_file);
+
+
+#endif //TEST_TEXTCODEC_H
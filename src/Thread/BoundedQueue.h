@@ -0,0 +1,66 @@
+#ifndef TEST_BOUNDEDQUEUE_H
+#define TEST_BOUNDEDQUEUE_H
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+// BoundedQueue pass items between threads
+// Push wait while queue is full, Pop wait while queue is empty
+// After Close no items can be pushed, Pop return false when closed queue become empty
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+    // Copying prohibited
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Return false if queue was closed and item wasn't pushed
+    bool Push(T item) {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->not_full.wait(lock, [this] { return this->closed || this->items.size() < this->capacity; });
+        if (this->closed) {
+            return false;
+        }
+
+        this->items.push_back(std::move(item));
+        this->not_empty.notify_one();
+        return true;
+    }
+
+    // Return false if queue was closed and there is no items
+    bool Pop(T& item) {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->not_empty.wait(lock, [this] { return this->closed || !this->items.empty(); });
+        if (this->items.empty()) {
+            return false;
+        }
+
+        item = std::move(this->items.front());
+        this->items.pop_front();
+        this->not_full.notify_one();
+        return true;
+    }
+
+    void Close() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->closed = true;
+        this->not_empty.notify_all();
+        this->not_full.notify_all();
+    }
+
+    ~BoundedQueue() = default;
+private:
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+};
+
+
+#endif //TEST_BOUNDEDQUEUE_H
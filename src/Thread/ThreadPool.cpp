@@ -0,0 +1,65 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int32_t threads) {
+    this->pending = 0;
+    this->stopped = false;
+
+    for (int32_t i = 0; i < std::max(1, threads); i++) {
+        this->threads.emplace_back(&ThreadPool::Work, this);
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->tasks.push_back(std::move(task));
+    this->pending++;
+    this->has_task.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->all_done.wait(lock, [this] { return this->pending == 0; });
+}
+
+int32_t ThreadPool::GetThreads() const {
+    return (int32_t) this->threads.size();
+}
+
+// Thread take tasks until pool is stopped and there is no tasks
+void ThreadPool::Work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->has_task.wait(lock, [this] { return this->stopped || !this->tasks.empty(); });
+            if (this->tasks.empty()) {
+                return;
+            }
+
+            task = std::move(this->tasks.front());
+            this->tasks.pop_front();
+        }
+
+        task();
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->pending--;
+        if (this->pending == 0) {
+            this->all_done.notify_all();
+        }
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopped = true;
+        this->has_task.notify_all();
+    }
+
+    for (auto& thread: this->threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef TEST_THREADPOOL_H
+#define TEST_THREADPOOL_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+// ThreadPool run tasks on fixed count of threads
+// Wait is barrier, it return when all submitted tasks are finished
+class ThreadPool {
+public:
+    explicit ThreadPool(int32_t threads);
+
+    // Copying prohibited
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task);
+    void Wait();
+
+    int32_t GetThreads() const;
+
+    // Destructor wait for all tasks
+    ~ThreadPool();
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    // Count of tasks that are submitted and not finished
+    int64_t pending;
+    bool stopped;
+    std::mutex mutex;
+    std::condition_variable has_task;
+    std::condition_variable all_done;
+
+    void Work();
+};
+
+
+#endif //TEST_THREADPOOL_H
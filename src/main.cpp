@@ -1,33 +1,125 @@
 #include "Tape/ITape.h"
 #include "Tape/Tape.h"
+#include "Tape/BinaryTape.h"
+#include "Tape/PrefetchingTape.h"
+#include "Tape/TextCodec.h"
 
 #include "Sort/ISort.h"
 #include "Sort/Sort.h"
+#include "Sort/MemoryPlan.h"
+
+#include <iostream>
+#include <vector>
+
+// Define values of --stats option
+#define STATS_OPTION_STR "--stats="
+#define STATS_JSON_STR "json"
+#define STATS_TEXT_STR "text"
+
+// Option that sort binary copies of input and output files
+#define BINARY_OPTION_STR "--binary"
+#define BINARY_INPUT_PATH "../../src/tmp/input.bin"
+#define BINARY_OUTPUT_PATH "../../src/tmp/output.bin"
+
+// Option that write only K least numbers to output file
+#define TOP_OPTION_STR "--top="
 
 void DeleteDirectoryContents(const std::string &dir_path) {
     for (const auto& entry : std::filesystem::directory_iterator(dir_path))
         std::filesystem::remove_all(entry.path());
 }
 
+// Usage: src [--stats=json|text] [--binary] [--top=K] [input_file output_file [M]]
+// M is memory limit in bytes, if it isn't set MEMORY_LIMIT from settings file is used
+// --stats print phases of sort and counters of tapes when sort is finished,
+// with json only stats are printed, so output can be parsed by scripts
+// --binary import input file to binary tape before sort and export binary output to output file after it,
+// so text is parsed and formatted only once
+// --top write K least numbers in sorted order instead of all numbers, they are selected without full sort
 int main(int argc, char** argv) {
     TapeSettings settings("../../src/settings.txt");
+    SortSettings sort_settings("../../src/settings.txt");
     const char* inpFile;
     const char* outFile;
 
     DeleteDirectoryContents("../../src/tmp");
 
-    if (argc > 1) {
-        inpFile = argv[1];
-        outFile = argv[2];
+    // Options can stay at any place, other arguments are positional
+    std::string stats_format;
+    bool binary = false;
+    int64_t top = -1;
+    std::vector<const char*> args;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (!arg.compare(0, 8, STATS_OPTION_STR)) {
+            stats_format = arg.substr(8);
+        } else if (arg == BINARY_OPTION_STR) {
+            binary = true;
+        } else if (!arg.compare(0, 6, TOP_OPTION_STR)) {
+            top = std::stoll(arg.substr(6));
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    bool json = stats_format == STATS_JSON_STR;
+
+    if (args.size() > 1) {
+        inpFile = args[0];
+        outFile = args[1];
     } else {
         inpFile = "../../src/input.txt";
         outFile = "../../src/output.txt";
     }
 
-    auto tape = (ITape*) new Tape(inpFile, settings);
+    // Tape create missing file, so typo in input path would give empty output
+    if (!std::filesystem::is_regular_file(inpFile)) {
+        std::cerr << "Input file " << inpFile << " doesn't exist" << std::endl;
+        return 1;
+    }
+
+    int64_t M = sort_settings.GetMemoryLimit();
+    if (args.size() > 2) {
+        M = std::stoll(args[2]);
+    }
+
+    // Input tape use same block as tapes of sort
+    MemoryPlan plan(M, sort_settings);
+    settings.SetBlockSize(plan.GetBlockSize());
+    if (!json) {
+        std::cout << plan.Report();
+    }
 
-    auto sort = (ISort*) new Sort(tape, outFile, 9);
-    sort->Start();
+    ITape* tape;
+    if (binary) {
+        ImportTextFile(inpFile, BINARY_INPUT_PATH);
+        tape = new BinaryTape(BINARY_INPUT_PATH, settings);
+        sort_settings.SetOutputFormat(TapeFormat::Binary);
+    } else {
+        tape = new Tape(inpFile, settings);
+    }
+    if (sort_settings.GetPrefetch()) {
+        tape = new PrefetchingTape(tape, plan.GetBlockSize());
+    }
+
+    auto sort = new Sort(tape, binary ? BINARY_OUTPUT_PATH : outFile, M, sort_settings);
+    if (top >= 0) {
+        sort->StartPartial(top);
+    } else {
+        sort->Start();
+    }
+    if (binary) {
+        ExportTextFile(BINARY_OUTPUT_PATH, outFile);
+    }
+
+    if (json) {
+        std::cout << sort->GetStats().ToJson() << std::endl;
+    } else {
+        // Time that tapes spent, with virtual clock it's modelled, not waited
+        std::cout << "Tape time: " << Clock::Global().GetElapsed().count() / 1000 << " ms" << std::endl;
+        if (stats_format == STATS_TEXT_STR) {
+            std::cout << sort->GetStats().Report();
+        }
+    }
 
     delete tape;
     delete sort;
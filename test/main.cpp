@@ -1,13 +1,30 @@
 #include "googletest/googletest/include/gtest/gtest.h"
 
 #include "../src/Tape/Tape.h"
+#include "../src/Tape/BinaryTape.h"
+#include "../src/Tape/MmapTape.h"
+#include "../src/Tape/CompressedTape.h"
+#include "../src/Tape/PrefetchingTape.h"
+#include "../src/Tape/TextCodec.h"
 #include "../src/Sort/Sort.h"
+#include "../src/Sort/LoserTree.h"
+#include "../src/Sort/PolyphaseMerge.h"
+#include "../src/Sort/RadixSort.h"
+#include "../src/Sort/Histogram.h"
+#include "../src/Thread/ThreadPool.h"
 
+#include <cstring>
 #include <fstream>
+#include <sstream>
+#include <random>
+#include <algorithm>
+#include <map>
 
 #define TEST_SETTINGS "../../test/test_settings"
 #define TEST_INPUT_FILE "../../test/test_input"
 #define TEST_OUTPUT_FILE "../../test/test_output"
+#define TEST_BINARY_FILE "../../test/test_binary"
+#define TEST_RANDOM_FILE "../../test/test_random"
 #define TMP_FOLDER "../../src/tmp"
 
 using namespace std;
@@ -19,6 +36,9 @@ TEST(TapeSettingsTest, empty_init) {
     ASSERT_EQ(settings->GetWriteDelay(), 0);
     ASSERT_EQ(settings->GetRewindDelay(), 0);
     ASSERT_EQ(settings->GetShiftDelay(), 0);
+    ASSERT_EQ(settings->GetFormat(), TapeFormat::Text);
+    ASSERT_EQ(settings->GetBlockSize(), DEFAULT_BLOCK_SIZE);
+    ASSERT_EQ(settings->GetClockMode(), ClockMode::Real);
 
     delete settings;
 }
@@ -31,10 +51,29 @@ TEST(TapeSettingsTest, file_init) {
     ASSERT_EQ(settings->GetWriteDelay(), 2);
     ASSERT_EQ(settings->GetRewindDelay(), 3);
     ASSERT_EQ(settings->GetShiftDelay(), 4);
+    ASSERT_EQ(settings->GetFormat(), TapeFormat::Binary);
+    ASSERT_EQ(settings->GetBlockSize(), 16);
+    ASSERT_EQ(settings->GetDelayModel(), DelayModel::Block);
+    ASSERT_EQ(settings->GetTransferDelay(), 50);
+    ASSERT_EQ(settings->GetClockMode(), ClockMode::Virtual);
+    ASSERT_EQ(settings->GetRewindCellDelay(), 10);
 
     delete settings;
 }
 
+TEST(TapeSettingsTest, block_delay) {
+    TapeSettings settings(2, 3, 0, 1);
+
+    // Cell model charge every cell as separate read and shift
+    ASSERT_EQ(settings.GetBlockDelay(settings.GetReadDelay(), 10), std::chrono::milliseconds(30));
+    ASSERT_EQ(settings.GetBlockDelay(settings.GetReadDelay(), 0), std::chrono::microseconds(0));
+
+    // Block model charge read and shift once and transfer of every cell
+    settings.SetDelayModel(DelayModel::Block);
+    settings.SetTransferDelay(100);
+    ASSERT_EQ(settings.GetBlockDelay(settings.GetWriteDelay(), 10), std::chrono::microseconds(4000 + 10 * 100));
+}
+
 TEST(TapeSettingsTest, param_init) {
     auto settings = new TapeSettings(1, 2, 3, 4);
 
@@ -43,9 +82,22 @@ TEST(TapeSettingsTest, param_init) {
     ASSERT_EQ(settings->GetRewindDelay(), 3);
     ASSERT_EQ(settings->GetShiftDelay(), 4);
 
+    // Rewind from far position is longer if rewind cell delay is set
+    ASSERT_EQ(settings->GetRewindTime(100), std::chrono::milliseconds(3));
+    settings->SetRewindCellDelay(10);
+    ASSERT_EQ(settings->GetRewindTime(100), std::chrono::milliseconds(4));
+
     delete settings;
 }
 
+TEST(TapeInitTest, open_error_test) {
+    // File can't be created in missing folder, tape report it instead of empty tape
+    TapeSettings settings;
+    std::string path = std::string(TMP_FOLDER) + "/missing/input.txt";
+    ASSERT_THROW(Tape(path, settings), std::runtime_error);
+    ASSERT_THROW(BinaryTape(path, settings), std::runtime_error);
+}
+
 TEST(TapeInitTest, init_test) {
     auto settings = new TapeSettings();
     std::string input(TEST_INPUT_FILE);
@@ -161,6 +213,16 @@ void RefreshTestInput() {
     test_file.close();
 }
 
+void RefreshTestOutput() {
+    // test_output file content should be: 1 2 3 4 5 6 7 8 9 10
+
+    ofstream test_file(TEST_OUTPUT_FILE);
+
+    test_file << " 1 2 3 4 5 6 7 8 9 10";
+
+    test_file.close();
+}
+
 void ClearTestInput() {
     ofstream test_file(TEST_INPUT_FILE, std::ofstream::out | std::ofstream::trunc);
     test_file.close();
@@ -174,6 +236,8 @@ TEST_F(TapeTest, write_test) {
         tape->ShiftLeft();
     }
 
+    // Changed block is written to file on rewind
+    tape->Rewind();
     RefreshTestInput();
 }
 
@@ -190,6 +254,7 @@ TEST_F(TapeTest, write_append_test) {
         tape->ShiftLeft();
     }
 
+    tape->Rewind();
     RefreshTestInput();
 }
 
@@ -216,88 +281,2151 @@ TEST(TapeEmptyTest, empty_tape) {
    RefreshTestInput();
 }
 
-void DeleteDirectoryContents(const std::string &dir_path) {
-    for (const auto& entry : std::filesystem::directory_iterator(dir_path))
-        std::filesystem::remove_all(entry.path());
+TEST(TapeBlockTest, small_block_test) {
+    // Block of 3 cells, so tape of 10 cells have 4 blocks
+    TapeSettings settings;
+    settings.SetBlockSize(3);
+    auto tape = new Tape(TEST_INPUT_FILE, settings);
+
+    // Change numbers to numbers with other length, so file parts after block should move
+    for (int i = 0; i < 10; i++) {
+        tape->Write(tape->Read() * 1000);
+        tape->ShiftLeft();
+    }
+    tape->Write(-1);
+
+    // Read tape backward through all blocks
+    for (int i = 0; i < 10; i++) {
+        tape->ShiftRight();
+        ASSERT_EQ(tape->Read(), (i + 1) * 1000);
+    }
+
+    // Reopen tape and check file
+    delete tape;
+    tape = new Tape(TEST_INPUT_FILE, settings);
+    ASSERT_EQ(tape->GetN(), 11);
+    for (int i = 0; i < 10; i++) {
+        ASSERT_EQ(tape->Read(), (10 - i) * 1000);
+        tape->ShiftLeft();
+    }
+    ASSERT_EQ(tape->Read(), -1);
+
+    delete tape;
+    RefreshTestInput();
 }
 
-struct SortTest : public testing::Test {
-    Sort* sort;
+TEST(TapeBlockTest, in_place_write_test) {
+    TapeSettings settings;
+    auto tape = new Tape(TEST_INPUT_FILE, settings);
+    auto size = std::filesystem::file_size(TEST_INPUT_FILE);
 
-    void SetUp() {
-        // Clear tmp folder
-        DeleteDirectoryContents(TMP_FOLDER);
-        // Create tape
-        auto settings = new TapeSettings();
-        std::string input(TEST_INPUT_FILE);
-        auto tape = new Tape(input, *settings);
+    // Shorter number is written in place of "10", so file is not moved
+    tape->Write(7);
+    tape->Rewind();
+    ASSERT_EQ(std::filesystem::file_size(TEST_INPUT_FILE), size);
+    ASSERT_EQ(tape->Read(), 7);
+    tape->ShiftLeft();
+    ASSERT_EQ(tape->Read(), 9);
 
-        // Create sort
-        sort = new Sort(tape, TEST_OUTPUT_FILE, 5);
+    delete tape;
+    RefreshTestInput();
+}
+
+TEST(TapeBlockTest, truncate_test) {
+    TapeSettings settings;
+    settings.SetBlockSize(4);
+    auto tape = new Tape(TEST_INPUT_FILE, settings);
+
+    for (int i = 0; i < 6; i++) {
+        tape->ShiftLeft();
+    }
+    tape->Truncate();
+    ASSERT_EQ(tape->GetN(), 6);
+
+    // Tape can be written after truncate
+    tape->Write(100);
+    delete tape;
+
+    tape = new Tape(TEST_INPUT_FILE, settings);
+    ASSERT_EQ(tape->GetN(), 7);
+    for (int i = 10; i > 4; i--) {
+        ASSERT_EQ(tape->Read(), i);
+        tape->ShiftLeft();
+    }
+    ASSERT_EQ(tape->Read(), 100);
+
+    // Truncate at the start make tape empty
+    tape->Rewind();
+    tape->Truncate();
+    ASSERT_EQ(tape->GetN(), 0);
+    ASSERT_EQ(std::filesystem::file_size(TEST_INPUT_FILE), (uintmax_t) 0);
+
+    delete tape;
+    RefreshTestInput();
+}
+
+// Read cells of text tape from right to left, every read load block after the last checkpoint
+// cell_bytes - the longest number with space
+void CheckIndexedReads(Tape* tape, std::vector<int32_t>& values, int64_t cell_bytes) {
+    // Rewind flush written block, so moving of file tail isn't counted
+    tape->Rewind();
+    while (tape->GetPosition() < tape->GetN()) {
+        tape->ShiftLeft();
+    }
+
+    for (int64_t i = (int64_t) values.size() - 1; i >= 0; i -= 97) {
+        while (tape->GetPosition() > i) {
+            tape->ShiftRight();
+        }
+        int64_t bytes_read = tape->GetStats().bytes_read;
+        ASSERT_EQ(tape->Read(), values[i]);
+        ASSERT_LE(tape->GetStats().bytes_read - bytes_read, (INDEX_STRIDE + 16) * cell_bytes);
+    }
+}
+
+TEST(TapeBlockTest, index_test) {
+    std::vector<int32_t> values;
+    ofstream file(TEST_RANDOM_FILE, std::ofstream::out | std::ofstream::trunc);
+    for (int32_t i = 0; i < 8 * INDEX_STRIDE + 5; i++) {
+        values.push_back(i % 10);
+        file << (i > 0 ? " " : "") << values.back();
+    }
+    file.close();
+
+    TapeSettings settings;
+    settings.SetBlockSize(16);
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+    CheckIndexedReads(tape, values, 2);
+
+    // Longer numbers move tail of file with its checkpoints
+    tape->Rewind();
+    for (int32_t i = 0; i < INDEX_STRIDE + 100; i++) {
+        if (i >= INDEX_STRIDE - 50) {
+            values[i] = -1000000 - i;
+            tape->Write(values[i]);
+        }
+        tape->ShiftLeft();
+    }
+    CheckIndexedReads(tape, values, 9);
+
+    // Truncated tape keep checkpoints before the head and get new ones for appended numbers
+    tape->Rewind();
+    for (int32_t i = 0; i < 6 * INDEX_STRIDE + 3; i++) {
+        tape->ShiftLeft();
+    }
+    tape->Truncate();
+    values.resize(6 * INDEX_STRIDE + 3);
+    for (int32_t i = 0; i < INDEX_STRIDE; i++) {
+        values.push_back(i);
+        tape->Write(i);
+        tape->ShiftLeft();
+    }
+    CheckIndexedReads(tape, values, 9);
+    delete tape;
+
+    // Index is built again when tape is opened
+    tape = new Tape(TEST_RANDOM_FILE, settings);
+    ASSERT_EQ(tape->GetN(), (int64_t) values.size());
+    CheckIndexedReads(tape, values, 9);
+    delete tape;
+
+    std::filesystem::remove(TEST_RANDOM_FILE);
+}
+
+struct BinaryTapeTest : public testing::Test {
+    BinaryTape *tape;
+    TapeSettings settings;
+
+    void SetUp() {
+        std::filesystem::remove(TEST_BINARY_FILE);
+        tape = new BinaryTape(TEST_BINARY_FILE, settings);
     }
 
     void TearDown() {
-        delete sort;
+        delete tape;
+        std::filesystem::remove(TEST_BINARY_FILE);
     }
 };
 
-TEST_F(SortTest, sort_test) {
-    sort->Start();
+TEST_F(BinaryTapeTest, empty_tape) {
+    EXPECT_EQ(tape->GetN(), 0);
+    EXPECT_EQ(tape->GetPosition(), 0);
 
-    // Create tape for output check
-    auto settings = new TapeSettings();
-    std::string output(TEST_OUTPUT_FILE);
-    auto out_tape = Tape(output, *settings);
+    tape->Write(-7);
+    EXPECT_EQ(tape->Read(), -7);
+    EXPECT_EQ(tape->GetN(), 1);
+}
 
-    // Check that all numbers sorted
-    int32_t prev = out_tape.Read();
-    for (int i = 0; i < out_tape.GetN(); i++, prev = out_tape.Read(), out_tape.ShiftLeft()) {
-        ASSERT_LE(prev, out_tape.Read());
+TEST_F(BinaryTapeTest, write_read_test) {
+    for (int i = 0; i < 10; i++) {
+        tape->Write(10 - i);
+        tape->ShiftLeft();
+    }
+    ASSERT_EQ(tape->GetN(), 10);
+
+    // Change cells in the middle of the tape
+    tape->ShiftRight();
+    tape->ShiftRight();
+    tape->Write(INT32_MIN);
+    tape->ShiftRight();
+    tape->Write(INT32_MAX);
+    ASSERT_EQ(tape->GetN(), 10);
+
+    // Reopen tape and check that N and cells were saved
+    delete tape;
+    ASSERT_EQ(std::filesystem::file_size(TEST_BINARY_FILE), (uintmax_t) 10 * CELL_SIZE);
+    tape = new BinaryTape(TEST_BINARY_FILE, settings);
+    ASSERT_EQ(tape->GetN(), 10);
+    for (int i = 0; i < 10; i++) {
+        if (i == 7) {
+            ASSERT_EQ(tape->Read(), INT32_MAX);
+        } else if (i == 8) {
+            ASSERT_EQ(tape->Read(), INT32_MIN);
+        } else {
+            ASSERT_EQ(tape->Read(), 10 - i);
+        }
+        tape->ShiftLeft();
     }
+
+    // Head in the end of the tape read last number
+    ASSERT_EQ(tape->Read(), 1);
 }
 
-TEST(SortMTest, sort_odd_test) {
-    DeleteDirectoryContents(TMP_FOLDER);
-    auto settings = new TapeSettings();
-    std::string input(TEST_INPUT_FILE);
-    auto tape = new Tape(input, *settings);
+TEST_F(BinaryTapeTest, small_block_test) {
+    delete tape;
+    settings.SetBlockSize(3);
+    tape = new BinaryTape(TEST_BINARY_FILE, settings);
 
-    // Default test_input have N=10
-    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 4);
+    for (int i = 0; i < 10; i++) {
+        tape->Write(i);
+        tape->ShiftLeft();
+    }
+    for (int i = 9; i >= 0; i--) {
+        tape->ShiftRight();
+        ASSERT_EQ(tape->Read(), i);
+        tape->Write(-i);
+    }
 
-    sort->Start();
+    delete tape;
+    tape = new BinaryTape(TEST_BINARY_FILE, settings);
+    ASSERT_EQ(tape->GetN(), 10);
+    for (int i = 0; i < 10; i++) {
+        ASSERT_EQ(tape->Read(), -i);
+        tape->ShiftLeft();
+    }
+}
 
-    // Create tape for output check
-    std::string output(TEST_OUTPUT_FILE);
-    auto out_tape = Tape(output, *settings);
+TEST_F(BinaryTapeTest, truncate_test) {
+    for (int i = 0; i < 10; i++) {
+        tape->Write(i);
+        tape->ShiftLeft();
+    }
 
-    // Check that all numbers sorted
-    int32_t prev = out_tape.Read();
-    for (int i = 0; i < out_tape.GetN(); i++, prev = out_tape.Read(), out_tape.ShiftLeft()) {
-        ASSERT_LE(prev, out_tape.Read());
+    tape->Rewind();
+    tape->ShiftLeft();
+    tape->ShiftLeft();
+    tape->Truncate();
+    ASSERT_EQ(tape->GetN(), 2);
+    tape->Write(42);
+
+    delete tape;
+    ASSERT_EQ(std::filesystem::file_size(TEST_BINARY_FILE), (uintmax_t) 3 * CELL_SIZE);
+    tape = new BinaryTape(TEST_BINARY_FILE, settings);
+    tape->ShiftLeft();
+    tape->ShiftLeft();
+    ASSERT_EQ(tape->Read(), 42);
+}
+
+TEST(BinaryTapeFormatTest, little_endian_test) {
+    char bytes[CELL_SIZE];
+    BinaryTape::EncodeCell(0x01020304, bytes);
+
+    ASSERT_EQ(bytes[0], 0x04);
+    ASSERT_EQ(bytes[1], 0x03);
+    ASSERT_EQ(bytes[2], 0x02);
+    ASSERT_EQ(bytes[3], 0x01);
+    ASSERT_EQ(BinaryTape::DecodeCell(bytes), 0x01020304);
+
+    BinaryTape::EncodeCell(-2, bytes);
+    ASSERT_EQ(BinaryTape::DecodeCell(bytes), -2);
+}
+
+TEST(MmapTapeTest, write_read_test) {
+    std::filesystem::remove(TEST_BINARY_FILE);
+    TapeSettings settings;
+    auto tape = new MmapTape(TEST_BINARY_FILE, settings);
+    ASSERT_EQ(tape->GetN(), 0);
+
+    // Write more than one chunk, so file should grow
+    for (int i = 0; i < MMAP_CHUNK_SIZE + 10; i++) {
+        tape->Write(i - 5);
+        tape->ShiftLeft();
+    }
+    tape->ShiftRight();
+    ASSERT_EQ(tape->Read(), MMAP_CHUNK_SIZE + 4);
+
+    // Cut the tape and change first cell
+    tape->Rewind();
+    for (int i = 0; i < 5; i++) {
+        tape->ShiftLeft();
+    }
+    tape->Truncate();
+    tape->Rewind();
+    tape->Write(INT32_MIN);
+    delete tape;
+
+    // File is same as binary tape file
+    ASSERT_EQ(std::filesystem::file_size(TEST_BINARY_FILE), (uintmax_t) 5 * CELL_SIZE);
+    auto binary = new BinaryTape(TEST_BINARY_FILE, settings);
+    ASSERT_EQ(binary->GetN(), 5);
+    ASSERT_EQ(binary->Read(), INT32_MIN);
+    for (int i = 1; i < 5; i++) {
+        binary->ShiftLeft();
+        ASSERT_EQ(binary->Read(), i - 5);
     }
+    delete binary;
+
+    std::filesystem::remove(TEST_BINARY_FILE);
 }
 
-TEST(SortMTest, sort_big_M_test) {
-    DeleteDirectoryContents(TMP_FOLDER);
-    auto settings = new TapeSettings();
-    std::string input(TEST_INPUT_FILE);
-    auto tape = new Tape(input, *settings);
+TEST(MmapTapeTest, open_test) {
+    std::filesystem::remove(TEST_BINARY_FILE);
+    TapeSettings settings;
+    auto binary = new BinaryTape(TEST_BINARY_FILE, settings);
+    std::vector<int32_t> values = {3, 1, 2};
+    binary->WriteBlock(values.data(), 3);
+    delete binary;
+
+    // Opened file isn't resized until write pass its end
+    auto tape = new MmapTape(TEST_BINARY_FILE, settings);
+    ASSERT_EQ(tape->GetN(), 3);
+    ASSERT_EQ(std::filesystem::file_size(TEST_BINARY_FILE), (uintmax_t) 3 * CELL_SIZE);
+    ASSERT_EQ(tape->Read(), 3);
+    tape->Write(4);
+    ASSERT_EQ(std::filesystem::file_size(TEST_BINARY_FILE), (uintmax_t) 3 * CELL_SIZE);
+    for (int i = 0; i < 3; i++) {
+        tape->ShiftLeft();
+    }
+    tape->Write(5);
+    ASSERT_GT(std::filesystem::file_size(TEST_BINARY_FILE), (uintmax_t) 4 * CELL_SIZE);
+    delete tape;
+    ASSERT_EQ(std::filesystem::file_size(TEST_BINARY_FILE), (uintmax_t) 4 * CELL_SIZE);
 
-    // Default test_input have N=10
-    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 40);
+    // Bytes that don't fill a cell aren't tape
+    std::filesystem::resize_file(TEST_BINARY_FILE, 4 * CELL_SIZE + 1);
+    ASSERT_THROW(MmapTape(TEST_BINARY_FILE, settings), std::runtime_error);
 
-    sort->Start();
+    std::filesystem::remove(TEST_BINARY_FILE);
+}
 
-    // Create tape for output check
-    std::string output(TEST_OUTPUT_FILE);
-    auto out_tape = Tape(output, *settings);
+TEST(MmapTapeTest, advise_test) {
+    std::filesystem::remove(TEST_BINARY_FILE);
+    TapeSettings settings;
+    auto tape = new MmapTape(TEST_BINARY_FILE, settings);
 
-    // Check that all numbers sorted
-    int32_t prev = out_tape.Read();
-    for (int i = 0; i < out_tape.GetN(); i++, prev = out_tape.Read(), out_tape.ShiftLeft()) {
-        ASSERT_LE(prev, out_tape.Read());
+    // Pages behind the head are released while tape is read by blocks that don't end at page border
+    int64_t n = 3 * MMAP_ADVISE_SIZE / CELL_SIZE + 123;
+    std::vector<int32_t> values(n);
+    for (int64_t i = 0; i < n; i++) {
+        values[i] = (int32_t) (i * 7);
+    }
+    tape->WriteBlock(values.data(), n);
+    tape->Rewind();
+
+    int64_t syscalls = tape->GetStats().syscalls;
+    std::vector<int32_t> block(1001);
+    for (int64_t i = 0; i < n;) {
+        int64_t read = tape->ReadBlock(block.data(), (int64_t) block.size());
+        for (int64_t j = 0; j < read; j++) {
+            ASSERT_EQ(block[j], (int32_t) ((i + j) * 7));
+        }
+        i += read;
+    }
+    ASSERT_GE(tape->GetStats().syscalls - syscalls, 2);
+
+    delete tape;
+    std::filesystem::remove(TEST_BINARY_FILE);
+}
+
+TEST(CompressedTapeTest, frame_test) {
+    // Sorted and descending numbers are delta encoded, payload is decoded from the end of memory
+    std::vector<std::vector<int32_t>> frames = {
+            {5, 7, 7, 100, 1000, 100000},
+            {300, 200, 100, -100, -1000},
+            {42},
+            {INT32_MIN, 0, INT32_MAX},
+            {1, -1, 1, -1, 1, -1, 1, -1}
+    };
+    for (auto& frame: frames) {
+        auto count = (int64_t) frame.size();
+        std::vector<int32_t> cells = frame;
+        cells.resize(count + 3);
+
+        bool raw;
+        int64_t payload = CompressedTape::EncodeFrame(cells.data(), count, raw);
+        ASSERT_LE(payload, count * CELL_SIZE);
+
+        auto bytes = (char*) cells.data();
+        std::memmove(bytes + cells.size() * CELL_SIZE - payload, bytes, payload);
+        CompressedTape::DecodeFrame(cells.data(), count, (int64_t) cells.size(), payload, raw);
+        ASSERT_EQ(std::vector<int32_t>(cells.begin(), cells.begin() + count), frame);
+    }
+
+    // Delta that don't fit MAX_DELTA_BYTES make frame raw
+    std::vector<int32_t> cells = {INT32_MIN, INT32_MAX};
+    bool raw;
+    ASSERT_EQ(CompressedTape::EncodeFrame(cells.data(), 2, raw), 2 * CELL_SIZE);
+    ASSERT_TRUE(raw);
+}
+
+TEST(CompressedTapeTest, write_read_test) {
+    std::filesystem::remove(TEST_BINARY_FILE);
+    TapeSettings settings;
+    settings.SetBlockSize(256);
+    auto tape = new CompressedTape(TEST_BINARY_FILE, settings);
+
+    // Sorted run take about one byte for number
+    std::vector<int32_t> values;
+    for (int32_t i = 0; i < 10000; i++) {
+        values.push_back(i * 3 - 15000);
+    }
+    tape->WriteBlock(values.data(), (int64_t) values.size());
+    tape->Rewind();
+    ASSERT_LT(tape->GetFileSize(), (int64_t) values.size() * CELL_SIZE / 3);
+    delete tape;
+    ASSERT_LT(std::filesystem::file_size(TEST_BINARY_FILE), values.size() * CELL_SIZE / 3);
+
+    // Frames are found by headers, blocks can be read in any order
+    tape = new CompressedTape(TEST_BINARY_FILE, settings);
+    ASSERT_EQ(tape->GetN(), 10000);
+    std::vector<int32_t> read(10000);
+    ASSERT_EQ(tape->ReadBlock(read.data(), 10000), 10000);
+    ASSERT_EQ(read, values);
+    ASSERT_EQ(tape->ReadBlockBackward(read.data(), 10000), 10000);
+    ASSERT_EQ(read[0], values.back());
+    ASSERT_EQ(read[9999], values[0]);
+
+    // Random numbers in the middle make frame longer, the rest of file is moved
+    for (int i = 0; i < 1000; i++) {
+        tape->ShiftLeft();
+    }
+    std::mt19937 generator(9);
+    std::vector<int32_t> random(300);
+    for (auto& value: random) {
+        value = (int32_t) generator();
+    }
+    tape->WriteBlock(random.data(), (int64_t) random.size());
+    std::copy(random.begin(), random.end(), values.begin() + 1000);
+
+    // Cut in the middle of block and append
+    for (int i = 0; i < 5000; i++) {
+        tape->ShiftLeft();
+    }
+    tape->Truncate();
+    values.resize(6300);
+    tape->Write(7);
+    tape->ShiftLeft();
+    values.push_back(7);
+    delete tape;
+
+    tape = new CompressedTape(TEST_BINARY_FILE, settings);
+    ASSERT_EQ(tape->GetN(), 6301);
+    read.resize(6301);
+    ASSERT_EQ(tape->ReadBlock(read.data(), 6301), 6301);
+    ASSERT_EQ(read, values);
+
+    // Cut on the border of blocks
+    tape->Rewind();
+    for (int i = 0; i < 512; i++) {
+        tape->ShiftLeft();
+    }
+    tape->Truncate();
+    ASSERT_EQ(tape->GetN(), 512);
+    tape->Rewind();
+    read.resize(512);
+    ASSERT_EQ(tape->ReadBlock(read.data(), 1000), 512);
+    ASSERT_EQ(read, std::vector<int32_t>(values.begin(), values.begin() + 512));
+    delete tape;
+
+    std::filesystem::remove(TEST_BINARY_FILE);
+}
+
+// Read whole compressed tape from the start
+std::vector<int32_t> ReadCompressedTape(TapeSettings& settings) {
+    CompressedTape tape(TEST_BINARY_FILE, settings);
+    std::vector<int32_t> read(tape.GetN());
+    tape.ReadBlock(read.data(), (int64_t) read.size());
+    return read;
+}
+
+TEST(CompressedTapeTest, block_size_test) {
+    std::filesystem::remove(TEST_BINARY_FILE);
+    TapeSettings settings;
+    settings.SetBlockSize(100);
+    auto tape = new CompressedTape(TEST_BINARY_FILE, settings);
+    std::vector<int32_t> values;
+    for (int32_t i = 0; i < 1000; i++) {
+        values.push_back(i * 5);
+    }
+    tape->WriteBlock(values.data(), (int64_t) values.size());
+    delete tape;
+
+    // Frames of 100 numbers are read by smaller and bigger blocks
+    settings.SetBlockSize(64);
+    ASSERT_EQ(ReadCompressedTape(settings), values);
+    settings.SetBlockSize(300);
+    ASSERT_EQ(ReadCompressedTape(settings), values);
+
+    // Block of other size split frames at its borders, random numbers make the middle frame longer
+    tape = new CompressedTape(TEST_BINARY_FILE, settings);
+    for (int i = 0; i < 450; i++) {
+        tape->ShiftLeft();
+    }
+    std::mt19937 generator(3);
+    for (int i = 0; i < 20; i++) {
+        values[450 + i] = (int32_t) generator();
+        tape->Write(values[450 + i]);
+        tape->ShiftLeft();
+    }
+    delete tape;
+    settings.SetBlockSize(64);
+    ASSERT_EQ(ReadCompressedTape(settings), values);
+
+    // Cut inside of frame that isn't on the border of block, then append
+    tape = new CompressedTape(TEST_BINARY_FILE, settings);
+    for (int i = 0; i < 777; i++) {
+        tape->ShiftLeft();
+    }
+    tape->Truncate();
+    tape->Write(-1);
+    values.resize(777);
+    values.push_back(-1);
+    delete tape;
+    settings.SetBlockSize(100);
+    ASSERT_EQ(ReadCompressedTape(settings), values);
+    tape = new CompressedTape(TEST_BINARY_FILE, settings);
+    ASSERT_EQ(std::filesystem::file_size(TEST_BINARY_FILE), (uintmax_t) tape->GetFileSize());
+    delete tape;
+
+    std::filesystem::remove(TEST_BINARY_FILE);
+}
+
+TEST(PrefetchingTapeTest, write_read_test) {
+    std::filesystem::remove(TEST_BINARY_FILE);
+    TapeSettings settings;
+    MemoryAccount account;
+    auto tape = new PrefetchingTape(new BinaryTape(TEST_BINARY_FILE, settings), 4, &account);
+    ASSERT_EQ(account.GetCurrent(), 4 * (int64_t) (sizeof(int32_t) + sizeof(int64_t)));
+
+    // Written numbers are queued, tape see them at once
+    for (int i = 0; i < 100; i++) {
+        tape->Write(i);
+        ASSERT_EQ(tape->Read(), i);
+        tape->ShiftLeft();
     }
+    ASSERT_EQ(tape->GetN(), 100);
+    ASSERT_EQ(tape->GetPosition(), 100);
+
+    tape->Rewind();
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(tape->Read(), i);
+        tape->ShiftLeft();
+    }
+    delete tape;
+
+    // All numbers are in file after destructor
+    ASSERT_EQ(std::filesystem::file_size(TEST_BINARY_FILE), (uintmax_t) 100 * CELL_SIZE);
+    ASSERT_EQ(account.GetCurrent(), 0);
+    std::filesystem::remove(TEST_BINARY_FILE);
+}
+
+TEST(PrefetchingTapeTest, direction_test) {
+    std::filesystem::remove(TEST_BINARY_FILE);
+    TapeSettings settings;
+    auto tape = new PrefetchingTape(new BinaryTape(TEST_BINARY_FILE, settings), 8);
+    for (int i = 0; i < 20; i++) {
+        tape->Write(i * 10);
+        tape->ShiftLeft();
+    }
+    tape->Rewind();
+
+    // Read ahead is dropped when head go back
+    for (int i = 0; i < 5; i++) {
+        tape->ShiftLeft();
+    }
+    ASSERT_EQ(tape->Read(), 50);
+    tape->ShiftRight();
+    ASSERT_EQ(tape->GetPosition(), 4);
+    ASSERT_EQ(tape->Read(), 40);
+
+    // Numbers after the head are changed in place and cut
+    tape->Write(-1);
+    tape->ShiftLeft();
+    tape->Write(-2);
+    tape->ShiftLeft();
+    tape->Truncate();
+    ASSERT_EQ(tape->GetN(), 6);
+    ASSERT_EQ(tape->GetPosition(), 6);
+
+    tape->Rewind();
+    std::vector<int32_t> values;
+    while (tape->GetPosition() < tape->GetN()) {
+        values.push_back(tape->Read());
+        tape->ShiftLeft();
+    }
+    ASSERT_EQ(values, std::vector<int32_t>({0, 10, 20, 30, -1, -2}));
+
+    delete tape;
+    std::filesystem::remove(TEST_BINARY_FILE);
+}
+
+TEST(PrefetchingTapeTest, block_test) {
+    std::filesystem::remove(TEST_BINARY_FILE);
+    TapeSettings settings;
+    settings.SetBlockSize(3);
+    auto tape = new PrefetchingTape(new BinaryTape(TEST_BINARY_FILE, settings), 5);
+
+    // Blocks are bigger than buffer and go around the ring
+    std::vector<int32_t> values(1000);
+    for (int i = 0; i < 1000; i++) {
+        values[i] = i * 7;
+    }
+    tape->WriteBlock(values.data(), 600);
+    tape->Write(values[600]);
+    tape->ShiftLeft();
+    tape->WriteBlock(values.data() + 601, 399);
+    ASSERT_EQ(tape->GetN(), 1000);
+
+    tape->Rewind();
+    std::vector<int32_t> read(1000);
+    ASSERT_EQ(tape->ReadBlock(read.data(), 333), 333);
+    ASSERT_EQ(tape->Read(), values[333]);
+    tape->ShiftLeft();
+    read[333] = values[333];
+    ASSERT_EQ(tape->ReadBlock(read.data() + 334, 1000), 666);
+    ASSERT_EQ(read, values);
+    delete tape;
+
+    ASSERT_EQ(std::filesystem::file_size(TEST_BINARY_FILE), (uintmax_t) 1000 * CELL_SIZE);
+    std::filesystem::remove(TEST_BINARY_FILE);
+}
+
+// Write and read tape by bulk methods across blocks, tape should be empty
+void CheckBulkMethods(ITape* tape) {
+    std::vector<int32_t> values = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    tape->WriteBlock(values.data(), (int64_t) values.size());
+    ASSERT_EQ(tape->GetN(), 10);
+    ASSERT_EQ(tape->GetPosition(), 10);
+
+    // Change numbers in the middle, then change the last ones and append after them
+    tape->Rewind();
+    tape->ShiftLeft();
+    tape->ShiftLeft();
+    std::vector<int32_t> middle = {-100, -200, -300, -400};
+    tape->WriteBlock(middle.data(), (int64_t) middle.size());
+    std::vector<int32_t> tail = {60, 70, 80, 90, 100, 110};
+    tape->WriteBlock(tail.data(), (int64_t) tail.size());
+    ASSERT_EQ(tape->GetN(), 12);
+
+    // Reading stop in the end of tape
+    tape->Rewind();
+    std::vector<int32_t> read(20);
+    ASSERT_EQ(tape->ReadBlock(read.data(), (int64_t) read.size()), 12);
+    read.resize(12);
+    ASSERT_EQ(read, std::vector<int32_t>({0, 1, -100, -200, -300, -400, 60, 70, 80, 90, 100, 110}));
+    ASSERT_EQ(tape->GetPosition(), 12);
+    ASSERT_EQ(tape->ReadBlock(read.data(), 1), 0);
+
+    // Backward reading go from the head to the start
+    ASSERT_EQ(tape->ReadBlockBackward(read.data(), 5), 5);
+    ASSERT_EQ(std::vector<int32_t>(read.begin(), read.begin() + 5), std::vector<int32_t>({110, 100, 90, 80, 70}));
+    ASSERT_EQ(tape->GetPosition(), 7);
+    ASSERT_EQ(tape->ReadBlockBackward(read.data(), 20), 7);
+    ASSERT_EQ(std::vector<int32_t>(read.begin(), read.begin() + 7),
+              std::vector<int32_t>({60, -400, -300, -200, -100, 1, 0}));
+    ASSERT_EQ(tape->GetPosition(), 0);
+    ASSERT_EQ(tape->ReadBlockBackward(read.data(), 1), 0);
+}
+
+TEST(TapeBulkTest, text_test) {
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    TapeSettings settings;
+    settings.SetBlockSize(3);
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+    CheckBulkMethods(tape);
+    delete tape;
+
+    // Numbers are in file after the tape is closed
+    tape = new Tape(TEST_RANDOM_FILE, settings);
+    ASSERT_EQ(tape->GetN(), 12);
+    for (int i = 0; i < 6; i++) {
+        tape->ShiftLeft();
+    }
+    ASSERT_EQ(tape->Read(), 60);
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+}
+
+TEST(TapeBulkTest, binary_test) {
+    TapeSettings settings;
+    settings.SetBlockSize(3);
+
+    std::filesystem::remove(TEST_BINARY_FILE);
+    auto binary = new BinaryTape(TEST_BINARY_FILE, settings);
+    CheckBulkMethods(binary);
+    delete binary;
+    ASSERT_EQ(std::filesystem::file_size(TEST_BINARY_FILE), (uintmax_t) 12 * CELL_SIZE);
+
+    std::filesystem::remove(TEST_BINARY_FILE);
+    auto mmap = new MmapTape(TEST_BINARY_FILE, settings);
+    CheckBulkMethods(mmap);
+    delete mmap;
+    ASSERT_EQ(std::filesystem::file_size(TEST_BINARY_FILE), (uintmax_t) 12 * CELL_SIZE);
+
+    // Frames of compressed tape become longer when numbers in the middle are changed
+    std::filesystem::remove(TEST_BINARY_FILE);
+    auto compressed = new CompressedTape(TEST_BINARY_FILE, settings);
+    CheckBulkMethods(compressed);
+    delete compressed;
+    compressed = new CompressedTape(TEST_BINARY_FILE, settings);
+    ASSERT_EQ(compressed->GetN(), 12);
+    std::vector<int32_t> read(12);
+    compressed->ReadBlock(read.data(), 12);
+    ASSERT_EQ(read, std::vector<int32_t>({0, 1, -100, -200, -300, -400, 60, 70, 80, 90, 100, 110}));
+    delete compressed;
+
+    // Prefetching tape copy numbers from and to its buffer
+    std::filesystem::remove(TEST_BINARY_FILE);
+    auto prefetching = new PrefetchingTape(new BinaryTape(TEST_BINARY_FILE, settings), 2);
+    CheckBulkMethods(prefetching);
+    delete prefetching;
+
+    std::filesystem::remove(TEST_BINARY_FILE);
+}
+
+void DeleteDirectoryContents(const std::string &dir_path) {
+    for (const auto& entry : std::filesystem::directory_iterator(dir_path))
+        std::filesystem::remove_all(entry.path());
+}
+
+TEST(ClockTest, virtual_test) {
+    Clock::Global().Reset();
+    DeviceTimer first(ClockMode::Virtual);
+    DeviceTimer second(ClockMode::Virtual);
+
+    // Virtual clock don't sleep, so an hour is modelled at once
+    auto begin = std::chrono::steady_clock::now();
+    first.Wait(std::chrono::hours(1));
+    ASSERT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(1));
+    ASSERT_EQ(first.GetDeviceTime(), std::chrono::hours(1));
+    ASSERT_EQ(Clock::Global().GetElapsed(), std::chrono::hours(1));
+
+    // Two threads with own tapes move at the same time, thread that use busy tape wait it
+    Clock::Global().Join();
+    std::thread other([&first, &second] {
+        second.Wait(std::chrono::minutes(30));
+        first.Wait(std::chrono::minutes(10));
+    });
+    other.join();
+    first.Wait(std::chrono::minutes(10));
+    Clock::Global().Join();
+
+    ASSERT_EQ(second.GetDeviceTime(), std::chrono::minutes(30));
+    ASSERT_EQ(first.GetDeviceTime(), std::chrono::minutes(80));
+    // Main thread wait first tape that is busy until 1h40m
+    ASSERT_EQ(Clock::Global().GetElapsed(), std::chrono::minutes(110));
+    ASSERT_EQ(Clock::Global().GetThreadTime(), std::chrono::minutes(110));
+}
+
+TEST(ClockTest, tape_test) {
+    // Delays are large, test would take minutes with real clock
+    TapeSettings settings(1000, 1000, 1000, 1000);
+    settings.SetClockMode(ClockMode::Virtual);
+    RefreshTestInput();
+    auto tape = new Tape(TEST_INPUT_FILE, settings);
+
+    for (int i = 0; i < 10; i++) {
+        tape->Read();
+        tape->ShiftLeft();
+    }
+    tape->Rewind();
+    ASSERT_EQ(tape->GetDeviceTime(), std::chrono::seconds(21));
+
+    auto prefetching = new PrefetchingTape(tape, 4);
+    ASSERT_EQ(prefetching->GetDeviceTime(), std::chrono::seconds(21));
+    delete prefetching;
+}
+
+TEST(ClockTest, prefetch_test) {
+    TapeSettings settings(1000, 1000, 1000, 1000);
+    settings.SetClockMode(ClockMode::Virtual);
+    std::filesystem::remove(TEST_BINARY_FILE);
+    Clock::Global().Reset();
+
+    // Thread that wrote numbers wait while background thread write them to tape
+    auto tape = new PrefetchingTape(new BinaryTape(TEST_BINARY_FILE, settings), 4);
+    std::vector<int32_t> values(10, 7);
+    tape->WriteBlock(values.data(), 10);
+    tape->Rewind();
+    ASSERT_GE(Clock::Global().GetThreadTime(), std::chrono::seconds(20));
+
+    // Thread that read numbers get them not earlier than background thread read them
+    auto start = Clock::Global().GetThreadTime();
+    ASSERT_EQ(tape->ReadBlock(values.data(), 10), 10);
+    ASSERT_GE(Clock::Global().GetThreadTime(), start + std::chrono::seconds(20));
+    ASSERT_EQ(Clock::Global().GetThreadTime(), Clock::Global().GetElapsed());
+    delete tape;
+
+    std::filesystem::remove(TEST_BINARY_FILE);
+}
+
+TEST(TapeStatsTest, counters_test) {
+    TapeSettings settings(1, 1, 1, 1);
+    settings.SetClockMode(ClockMode::Virtual);
+    settings.SetBlockSize(3);
+    StatsAccount account;
+    settings.SetStatsAccount(&account);
+
+    std::filesystem::remove(TEST_BINARY_FILE);
+    auto tape = new BinaryTape(TEST_BINARY_FILE, settings);
+    for (int32_t i = 0; i < 5; i++) {
+        tape->Write(i);
+        tape->ShiftLeft();
+    }
+    tape->Rewind();
+    int32_t values[5];
+    ASSERT_EQ(tape->ReadBlock(values, 5), 5);
+    tape->ShiftRight();
+    tape->ShiftRight();
+    ASSERT_EQ(tape->Read(), 3);
+
+    // Blocks of 3 and 2 cells are written once and read once
+    auto stats = tape->GetStats();
+    ASSERT_EQ(stats.reads, 6);
+    ASSERT_EQ(stats.writes, 5);
+    ASSERT_EQ(stats.shifts_left, 10);
+    ASSERT_EQ(stats.shifts_right, 2);
+    ASSERT_EQ(stats.rewinds, 1);
+    ASSERT_EQ(stats.bytes_read, 5 * CELL_SIZE);
+    ASSERT_EQ(stats.bytes_written, 5 * CELL_SIZE);
+    ASSERT_GE(stats.syscalls, 4);
+    ASSERT_EQ(stats.delay, tape->GetDeviceTime().count());
+
+    // Counters are added to account when tape is deleted
+    ASSERT_EQ(account.GetTapes(), 0);
+    delete tape;
+    ASSERT_EQ(account.GetTapes(), 1);
+    ASSERT_EQ(account.GetTotal().reads, 6);
+    ASSERT_EQ(account.GetTotal().shifts_left, 10);
+
+    std::filesystem::remove(TEST_BINARY_FILE);
+}
+
+TEST(RadixSortTest, sort_test) {
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int32_t> distribution(INT32_MIN, INT32_MAX);
+    std::uniform_int_distribution<int32_t> small_distribution(-3, 3);
+
+    // Short array is sorted by std::sort, long ones by radix sort
+    for (size_t n: {0, 10, 1000, 5000}) {
+        std::vector<int32_t> values(n);
+        for (size_t i = 0; i < n; i++) {
+            // Half of numbers are repeated, and extreme values are present
+            values[i] = i % 2 ? distribution(generator) : small_distribution(generator);
+        }
+        if (n > 2) {
+            values[0] = INT32_MIN;
+            values[1] = INT32_MAX;
+        }
+        std::vector<int32_t> expected = values;
+        std::sort(expected.begin(), expected.end());
+
+        std::vector<int32_t> scratch(n);
+        RadixSort(values.data(), scratch.data(), n);
+        ASSERT_EQ(values, expected);
+    }
+
+    // Numbers that differ only in low digit, high passes are skipped
+    std::vector<int32_t> values(RADIX_MIN_SIZE);
+    for (int32_t i = 0; i < RADIX_MIN_SIZE; i++) {
+        values[i] = RADIX_MIN_SIZE - i;
+    }
+    std::vector<int32_t> scratch(values.size());
+    RadixSort(values.data(), scratch.data(), values.size());
+    ASSERT_TRUE(std::is_sorted(values.begin(), values.end()));
+}
+
+TEST(HistogramTest, count_test) {
+    // Table grow from HISTOGRAM_MIN_SLOTS while distinct numbers are added
+    std::vector<int32_t> values;
+    std::map<int32_t, int64_t> expected;
+    for (int32_t i = 0; i < 5000; i++) {
+        int32_t value = i % 2 ? (i % 1500) * 1000 : INT32_MIN + i % 7;
+        values.push_back(value);
+        expected[value]++;
+    }
+    values.push_back(INT32_MAX);
+    expected[INT32_MAX]++;
+
+    MemoryAccount account(1 << 20);
+    auto histogram = new Histogram(4096, &account);
+    ASSERT_TRUE(histogram->Add(values.data(), (int64_t) values.size()));
+    ASSERT_EQ(histogram->GetDistinct(), (int64_t) expected.size());
+
+    auto& slots = histogram->Sort();
+    ASSERT_EQ(slots.size(), expected.size());
+    auto it = expected.begin();
+    for (auto& slot: slots) {
+        ASSERT_EQ(slot.value, it->first);
+        ASSERT_EQ(slot.count, it->second);
+        it++;
+    }
+    ASSERT_GT(account.GetPeak(), 0);
+    delete histogram;
+
+    // Table can't be half full with max slots
+    Histogram small_histogram(8);
+    ASSERT_TRUE(small_histogram.Add(values.data(), 2));
+    ASSERT_FALSE(small_histogram.Add(values.data() + 2, 10));
+}
+
+TEST(ThreadPoolTest, wait_test) {
+    ThreadPool pool(3);
+    std::atomic<int32_t> done(0);
+
+    // Pool can be used for several rounds
+    for (int round = 1; round <= 2; round++) {
+        for (int i = 0; i < 50; i++) {
+            pool.Submit([&done] { done++; });
+        }
+        pool.Wait();
+        ASSERT_EQ(done.load(), round * 50);
+    }
+}
+
+// Write N random numbers to text file and return them
+std::vector<int32_t> CreateRandomInput(int64_t n, uint32_t seed) {
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int32_t> distribution(INT32_MIN, INT32_MAX);
+
+    std::vector<int32_t> values;
+    ofstream test_file(TEST_RANDOM_FILE, std::ofstream::out | std::ofstream::trunc);
+    for (int64_t i = 0; i < n; i++) {
+        values.push_back(distribution(generator));
+        test_file << (i > 0 ? " " : "") << values.back();
+    }
+    test_file.close();
+
+    return values;
+}
+
+// Check that output file store sorted values
+void CheckSortedOutput(std::vector<int32_t> values) {
+    std::sort(values.begin(), values.end());
+
+    TapeSettings settings;
+    auto out_tape = Tape(TEST_OUTPUT_FILE, settings);
+    ASSERT_EQ(out_tape.GetN(), (int64_t) values.size());
+    for (auto value: values) {
+        ASSERT_EQ(out_tape.Read(), value);
+        out_tape.ShiftLeft();
+    }
+}
+
+TEST(TextCodecTest, reader_test) {
+    // Small buffer split numbers between reads
+    std::stringstream stream(" 12 -2147483648\n2147483647\r\n\t0 -7 123456789");
+    TextReader reader(stream, 0, 16);
+
+    std::vector<int32_t> expected = {12, INT32_MIN, INT32_MAX, 0, -7, 123456789};
+    int32_t value;
+    for (auto number: expected) {
+        ASSERT_TRUE(reader.Next(value));
+        ASSERT_EQ(value, number);
+    }
+    ASSERT_FALSE(reader.Next(value));
+    ASSERT_EQ(reader.GetOffset(), (int64_t) stream.str().size());
+
+    // Offset point after the last parsed number, reader from it continue parsing
+    TextReader from_offset(stream, 3, 16);
+    ASSERT_TRUE(from_offset.Next(value));
+    ASSERT_EQ(value, INT32_MIN);
+    ASSERT_EQ(from_offset.GetOffset(), 15);
+
+    // Parsing stop on text that isn't number
+    std::stringstream wrong("1 x 2");
+    TextReader wrong_reader(wrong, 0, 16);
+    ASSERT_TRUE(wrong_reader.Next(value));
+    ASSERT_FALSE(wrong_reader.Next(value));
+}
+
+TEST(TextCodecTest, format_test) {
+    char text[MAX_CELL_LENGTH];
+    ASSERT_EQ(std::string(text, FormatCell(INT32_MIN, text)), "-2147483648");
+    ASSERT_EQ(std::string(text, FormatCell(INT32_MAX, text)), "2147483647");
+    ASSERT_EQ(std::string(text, FormatCell(0, text)), "0");
+    ASSERT_EQ(std::string(text, FormatCell(-42, text)), "-42");
+}
+
+TEST(TextCodecTest, import_export_test) {
+    // Numbers are more than one buffer of import and export
+    int64_t n = 3 * TEXT_BUFFER_SIZE / CELL_SIZE + 5;
+    auto values = CreateRandomInput(n, 11);
+    values.push_back(INT32_MIN);
+    values.push_back(INT32_MAX);
+    {
+        ofstream test_file(TEST_RANDOM_FILE, std::ofstream::out | std::ofstream::app);
+        test_file << "\n" << INT32_MIN << "  " << INT32_MAX << "\n";
+    }
+    n += 2;
+
+    ASSERT_EQ(ImportTextFile(TEST_RANDOM_FILE, TEST_BINARY_FILE), n);
+    ASSERT_EQ(std::filesystem::file_size(TEST_BINARY_FILE), (uintmax_t) n * CELL_SIZE);
+
+    TapeSettings settings;
+    auto binary = new BinaryTape(TEST_BINARY_FILE, settings);
+    std::vector<int32_t> read(n);
+    ASSERT_EQ(binary->ReadBlock(read.data(), n), n);
+    ASSERT_EQ(read, values);
+    delete binary;
+
+    // Exported file is read by text tape
+    ASSERT_EQ(ExportTextFile(TEST_BINARY_FILE, TEST_RANDOM_FILE), n);
+    auto text = new Tape(TEST_RANDOM_FILE, settings);
+    ASSERT_EQ(text->GetN(), n);
+    ASSERT_EQ(text->ReadBlock(read.data(), n), n);
+    ASSERT_EQ(read, values);
+    delete text;
+
+    std::filesystem::remove(TEST_BINARY_FILE);
+    std::filesystem::remove(TEST_RANDOM_FILE);
+}
+
+TEST(TextCodecTest, binary_output_sort_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    auto values = CreateRandomInput(300, 21);
+    ImportTextFile(TEST_RANDOM_FILE, TEST_BINARY_FILE);
+
+    // Sort of binary tapes, output is exported to text by caller
+    TapeSettings settings;
+    auto tape = new BinaryTape(TEST_BINARY_FILE, settings);
+    SortSettings sort_settings;
+    sort_settings.SetOutputFormat(TapeFormat::Binary);
+    std::string binary_output = std::string(TMP_FOLDER) + "/output.bin";
+    auto sort = new Sort(tape, binary_output, 256, sort_settings);
+    sort->Start();
+    delete sort;
+    delete tape;
+
+    ASSERT_EQ(std::filesystem::file_size(binary_output), (uintmax_t) values.size() * CELL_SIZE);
+    ASSERT_EQ(ExportTextFile(binary_output, TEST_OUTPUT_FILE), (int64_t) values.size());
+    CheckSortedOutput(values);
+
+    std::filesystem::remove(TEST_BINARY_FILE);
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+struct SortTest : public testing::Test {
+    Sort* sort;
+
+    void SetUp() {
+        // Clear tmp folder
+        DeleteDirectoryContents(TMP_FOLDER);
+        // Create tape
+        auto settings = new TapeSettings();
+        std::string input(TEST_INPUT_FILE);
+        auto tape = new Tape(input, *settings);
+
+        // Create sort
+        sort = new Sort(tape, TEST_OUTPUT_FILE, 160);
+    }
+
+    void TearDown() {
+        delete sort;
+    }
+};
+
+TEST_F(SortTest, sort_test) {
+    sort->Start();
+
+    // Create tape for output check
+    auto settings = new TapeSettings();
+    std::string output(TEST_OUTPUT_FILE);
+    auto out_tape = Tape(output, *settings);
+
+    // Check that all numbers sorted
+    int32_t prev = out_tape.Read();
+    for (int i = 0; i < out_tape.GetN(); i++, prev = out_tape.Read(), out_tape.ShiftLeft()) {
+        ASSERT_LE(prev, out_tape.Read());
+    }
+}
+
+TEST(SortMTest, sort_odd_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    auto settings = new TapeSettings();
+    std::string input(TEST_INPUT_FILE);
+    auto tape = new Tape(input, *settings);
+
+    // Default test_input have N=10, smallest M that fits balanced merge
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 124);
+
+    sort->Start();
+
+    // Create tape for output check
+    std::string output(TEST_OUTPUT_FILE);
+    auto out_tape = Tape(output, *settings);
+
+    // Check that all numbers sorted
+    int32_t prev = out_tape.Read();
+    for (int i = 0; i < out_tape.GetN(); i++, prev = out_tape.Read(), out_tape.ShiftLeft()) {
+        ASSERT_LE(prev, out_tape.Read());
+    }
+}
+
+TEST(SortMTest, sort_big_M_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    auto settings = new TapeSettings();
+    std::string input(TEST_INPUT_FILE);
+    auto tape = new Tape(input, *settings);
+
+    // Default test_input have N=10
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 4096);
+
+    sort->Start();
+
+    // Create tape for output check
+    std::string output(TEST_OUTPUT_FILE);
+    auto out_tape = Tape(output, *settings);
+
+    // Check that all numbers sorted
+    int32_t prev = out_tape.Read();
+    for (int i = 0; i < out_tape.GetN(); i++, prev = out_tape.Read(), out_tape.ShiftLeft()) {
+        ASSERT_LE(prev, out_tape.Read());
+    }
+}
+
+TEST(SortMTest, sort_reuse_tmp_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    auto values = CreateRandomInput(100, 4);
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    // 4 runs of 27 numbers need 2 rounds of merge by 2, only 2 folders are used
+    SortSettings sort_settings;
+    sort_settings.SetRunGeneration(RunGeneration::Chunk);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 128, sort_settings);
+    ASSERT_EQ(sort->GetMemoryPlan().GetRunBuffer(), 27);
+    ASSERT_EQ(sort->GetMemoryPlan().GetFanIn(), 2);
+    sort->Start();
+
+    int folders = 0;
+    for (auto& entry: std::filesystem::directory_iterator(TMP_FOLDER)) {
+        ASSERT_TRUE(entry.path().filename() == "0" || entry.path().filename() == "1");
+        folders++;
+    }
+    ASSERT_EQ(folders, 2);
+
+    CheckSortedOutput(values);
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+TEST(LoserTreeTest, merge_test) {
+    // 5 sorted tapes with different length, one of them is empty
+    TapeSettings settings;
+    std::vector<ITape*> tapes;
+    std::vector<int32_t> expected;
+    for (int t = 0; t < 5; t++) {
+        std::string file = std::string(TEST_BINARY_FILE) + std::to_string(t);
+        std::filesystem::remove(file);
+        auto tape = new BinaryTape(file, settings);
+        for (int i = 0; i < t * 3; i++) {
+            tape->Write(i * t - 10);
+            tape->ShiftLeft();
+            expected.push_back(i * t - 10);
+        }
+        tape->Rewind();
+        tapes.push_back(tape);
+    }
+    std::sort(expected.begin(), expected.end());
+
+    LoserTree tree(tapes);
+    std::vector<int32_t> merged;
+    while (!tree.Empty()) {
+        merged.push_back(tree.Top());
+        tree.Pop();
+    }
+    ASSERT_EQ(merged, expected);
+
+    // Tapes read by blocks give same result
+    for (auto tape: tapes) {
+        tape->Rewind();
+    }
+    LoserTree buffered_tree(tapes, nullptr, 4);
+    merged.clear();
+    while (!buffered_tree.Empty()) {
+        merged.push_back(buffered_tree.Top());
+        buffered_tree.Pop();
+    }
+    ASSERT_EQ(merged, expected);
+
+    for (int t = 0; t < 5; t++) {
+        delete tapes[t];
+        std::filesystem::remove(std::string(TEST_BINARY_FILE) + std::to_string(t));
+    }
+}
+
+TEST(SortMTest, sort_k_way_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    auto values = CreateRandomInput(300, 1);
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    // 6 runs of 54 numbers are merged by 3 in 2 rounds
+    SortSettings sort_settings;
+    sort_settings.SetRunGeneration(RunGeneration::Chunk);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 256, sort_settings);
+    ASSERT_EQ(sort->GetMemoryPlan().GetFanIn(), 3);
+    sort->Start();
+
+    CheckSortedOutput(values);
+    ASSERT_LE(sort->GetPeakMemory(), 256);
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+TEST(SortSettingsTest, empty_init) {
+    SortSettings settings;
+
+    ASSERT_EQ(settings.GetRunGeneration(), RunGeneration::Chunk);
+    ASSERT_EQ(settings.GetMergeMode(), MergeMode::Balanced);
+    ASSERT_EQ(settings.GetTempTapes(), DEFAULT_TEMP_TAPES);
+    ASSERT_EQ(settings.GetMemoryLimit(), DEFAULT_MEMORY_LIMIT);
+    ASSERT_EQ(settings.GetSortThreads(), 0);
+    ASSERT_EQ(settings.GetSortKernel(), SortKernel::Std);
+    ASSERT_EQ(settings.GetDrives(), 1);
+    ASSERT_FALSE(settings.GetPrefetch());
+    ASSERT_EQ(settings.GetStrategy(), SortStrategy::Merge);
+    ASSERT_FALSE(settings.GetCounting());
+
+    // There can't be less than 3 tapes for polyphase merge
+    settings.SetTempTapes(1);
+    ASSERT_EQ(settings.GetTempTapes(), MIN_TEMP_TAPES);
+}
+
+TEST(SortSettingsTest, file_init) {
+    SortSettings settings(TEST_SETTINGS);
+
+    ASSERT_EQ(settings.GetRunGeneration(), RunGeneration::ReplacementSelection);
+    ASSERT_EQ(settings.GetMergeMode(), MergeMode::Polyphase);
+    ASSERT_EQ(settings.GetTempTapes(), 5);
+    ASSERT_EQ(settings.GetMemoryLimit(), 4096);
+    ASSERT_EQ(settings.GetSortThreads(), 3);
+    ASSERT_EQ(settings.GetSortKernel(), SortKernel::Radix);
+    ASSERT_EQ(settings.GetDrives(), 3);
+    ASSERT_TRUE(settings.GetPrefetch());
+}
+
+TEST(SortMTest, sort_chunk_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    auto values = CreateRandomInput(50, 2);
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    SortSettings sort_settings;
+    sort_settings.SetRunGeneration(RunGeneration::Chunk);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 128, sort_settings);
+    sort->Start();
+
+    CheckSortedOutput(values);
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+TEST(SortMTest, sort_replacement_selection_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    auto values = CreateRandomInput(50, 3);
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    SortSettings sort_settings;
+    sort_settings.SetRunGeneration(RunGeneration::ReplacementSelection);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 128, sort_settings);
+    sort->Start();
+
+    CheckSortedOutput(values);
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+// Sort numbers with natural run generation, check output and return count of runs
+int64_t CheckNaturalSort(const std::vector<int32_t>& values, MergeMode merge_mode) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    {
+        ofstream test_file(TEST_RANDOM_FILE, std::ofstream::out | std::ofstream::trunc);
+        for (size_t i = 0; i < values.size(); i++) {
+            test_file << (i > 0 ? " " : "") << values[i];
+        }
+    }
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    SortSettings sort_settings;
+    sort_settings.SetRunGeneration(RunGeneration::Natural);
+    sort_settings.SetMergeMode(merge_mode);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 256, sort_settings);
+    sort->Start();
+
+    CheckSortedOutput(values);
+    EXPECT_LE(sort->GetPeakMemory(), 256);
+    int64_t runs = sort->GetStats().GetRuns();
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+
+    return runs;
+}
+
+TEST(SortMTest, sort_natural_test) {
+    auto random = CreateRandomInput(300, 6);
+    ASSERT_GT(CheckNaturalSort(random, MergeMode::Balanced), 1);
+
+    // Time ordered batches give run for every batch, even if batch is longer than run buffer
+    std::vector<int32_t> batches;
+    for (int32_t batch = 0; batch < 5; batch++) {
+        for (int32_t i = 0; i < 60; i++) {
+            batches.push_back(batch * 3 + i * 10);
+        }
+    }
+    ASSERT_EQ(CheckNaturalSort(batches, MergeMode::Balanced), 5);
+    ASSERT_EQ(CheckNaturalSort(batches, MergeMode::Polyphase), 5);
+
+    // Descending stretches are reversed in memory
+    std::vector<int32_t> descending;
+    for (int32_t i = 300; i > 0; i--) {
+        descending.push_back(i % 100 == 0 ? -i : i);
+    }
+    CheckNaturalSort(descending, MergeMode::Balanced);
+
+    // Sorted prefix is longer than run buffer, so copy to output is started and dropped
+    std::vector<int32_t> prefix;
+    for (int32_t i = 0; i < 200; i++) {
+        prefix.push_back(i);
+    }
+    prefix.insert(prefix.end(), random.begin(), random.begin() + 100);
+    CheckNaturalSort(prefix, MergeMode::Balanced);
+    CheckNaturalSort(prefix, MergeMode::Polyphase);
+}
+
+TEST(SortMTest, sort_natural_sorted_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    std::vector<int32_t> values;
+    {
+        ofstream test_file(TEST_RANDOM_FILE, std::ofstream::out | std::ofstream::trunc);
+        for (int32_t i = 0; i < 300; i++) {
+            values.push_back(i / 2 - 50);
+            test_file << (i > 0 ? " " : "") << values.back();
+        }
+    }
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+    SortSettings sort_settings;
+    sort_settings.SetRunGeneration(RunGeneration::Natural);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 256, sort_settings);
+    sort->Start();
+    CheckSortedOutput(values);
+
+    // Sorted input is copied to output tape in one pass without temp tapes
+    auto& stats = sort->GetStats();
+    ASSERT_EQ(stats.GetRuns(), 1);
+    ASSERT_EQ(stats.GetPhases().size(), (size_t) 1);
+    ASSERT_EQ(stats.GetPhases()[0].name, "sorted_copy");
+    ASSERT_EQ(stats.GetTempStats().reads, 0);
+    ASSERT_EQ(stats.GetTempStats().writes, 0);
+    ASSERT_FALSE(std::filesystem::exists(std::string(TMP_FOLDER) + "/0"));
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+TEST(SortMTest, sort_pipeline_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    auto values = CreateRandomInput(150, 5);
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    // 4 buffers of 26 numbers are shared by reader, 2 sort threads and writer
+    SortSettings sort_settings;
+    sort_settings.SetRunGeneration(RunGeneration::Chunk);
+    sort_settings.SetSortThreads(2);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 512, sort_settings);
+    ASSERT_EQ(sort->GetMemoryPlan().GetRunBuffers(), 4);
+    sort->Start();
+
+    CheckSortedOutput(values);
+    ASSERT_LE(sort->GetPeakMemory(), 512);
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+TEST(SortMTest, sort_radix_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    auto values = CreateRandomInput(600, 6);
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    // 3 runs of 271 numbers are sorted by radix sort
+    SortSettings sort_settings;
+    sort_settings.SetRunGeneration(RunGeneration::Chunk);
+    sort_settings.SetSortKernel(SortKernel::Radix);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 2600, sort_settings);
+    ASSERT_TRUE(sort->GetMemoryPlan().GetRadixSort());
+    ASSERT_EQ(sort->GetMemoryPlan().GetRunBuffer(), 271);
+    sort->Start();
+
+    CheckSortedOutput(values);
+    ASSERT_LE(sort->GetPeakMemory(), 2600);
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+TEST(SortMTest, sort_drives_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    auto values = CreateRandomInput(300, 7);
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    // 6 runs of 59 numbers, 3 pairs of first round are merged by 2 drives at the same time
+    SortSettings sort_settings;
+    sort_settings.SetRunGeneration(RunGeneration::Chunk);
+    sort_settings.SetDrives(2);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 256, sort_settings);
+    ASSERT_EQ(sort->GetMemoryPlan().GetRunBuffer(), 59);
+    ASSERT_EQ(sort->GetMemoryPlan().GetMergeThreads(), 2);
+    sort->Start();
+
+    CheckSortedOutput(values);
+    ASSERT_LE(sort->GetPeakMemory(), 256);
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+TEST(SortMTest, sort_prefetch_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    auto values = CreateRandomInput(300, 8);
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    // All temp tapes and output tape read ahead and write behind
+    SortSettings sort_settings;
+    sort_settings.SetRunGeneration(RunGeneration::Chunk);
+    sort_settings.SetPrefetch(true);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 512, sort_settings);
+    sort->Start();
+
+    CheckSortedOutput(values);
+    ASSERT_LE(sort->GetPeakMemory(), 512);
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+TEST(SortMTest, sort_sorted_input_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+
+    // Sorted input give only one run with replacement selection, even if it much longer than heap
+    TapeSettings settings;
+    auto copy = new Tape(TEST_RANDOM_FILE, settings);
+    copy->Truncate();
+    for (int i = 0; i < 100; i++) {
+        copy->Write(i);
+        copy->ShiftLeft();
+    }
+    copy->Rewind();
+
+    SortSettings sort_settings;
+    sort_settings.SetRunGeneration(RunGeneration::ReplacementSelection);
+    auto sort = new Sort(copy, TEST_OUTPUT_FILE, 128, sort_settings);
+    sort->Start();
+
+    int64_t runs = std::distance(std::filesystem::directory_iterator(std::string(TMP_FOLDER) + "/0"),
+                                 std::filesystem::directory_iterator());
+    ASSERT_EQ(runs, 1);
+    ASSERT_FALSE(std::filesystem::exists(std::string(TMP_FOLDER) + "/1"));
+
+    delete sort;
+    delete copy;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+TEST(SortMTest, sort_single_run_move_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    TapeSettings settings;
+    auto copy = new Tape(TEST_RANDOM_FILE, settings);
+    copy->Truncate();
+    for (int i = 0; i < 100; i++) {
+        copy->Write(i);
+        copy->ShiftLeft();
+    }
+    copy->Rewind();
+
+    // The only run has format of binary output, so its file become output file without copy
+    SortSettings sort_settings;
+    sort_settings.SetRunGeneration(RunGeneration::ReplacementSelection);
+    sort_settings.SetOutputFormat(TapeFormat::Binary);
+    std::string binary_output = std::string(TMP_FOLDER) + "/output.bin";
+    auto sort = new Sort(copy, binary_output, 128, sort_settings);
+    sort->Start();
+
+    auto& phases = sort->GetStats().GetPhases();
+    ASSERT_EQ(phases.back().name, "final_move");
+    ASSERT_EQ(sort->GetStats().GetOutputStats().writes, 100);
+    ASSERT_TRUE(std::filesystem::is_empty(std::string(TMP_FOLDER) + "/0"));
+    delete sort;
+    delete copy;
+
+    auto out = new BinaryTape(binary_output, settings);
+    ASSERT_EQ(out->GetN(), 100);
+    std::vector<int32_t> read(100);
+    out->ReadBlock(read.data(), 100);
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(read[i], i);
+    }
+    delete out;
+
+    std::filesystem::remove(binary_output);
+    std::filesystem::remove(TEST_RANDOM_FILE);
+}
+
+TEST(SortMTest, sort_direct_test) {
+    // Input that fit run buffer is written straight to output tape
+    for (int64_t n: {0, 1, 50}) {
+        DeleteDirectoryContents(TMP_FOLDER);
+        auto values = CreateRandomInput(n, 7);
+
+        TapeSettings settings;
+        auto tape = new Tape(TEST_RANDOM_FILE, settings);
+        auto sort = new Sort(tape, TEST_OUTPUT_FILE, 1024, SortSettings());
+        sort->Start();
+
+        CheckSortedOutput(values);
+        ASSERT_FALSE(std::filesystem::exists(std::string(TMP_FOLDER) + "/0"));
+        ASSERT_EQ(sort->GetStats().GetRuns(), n > 0 ? 1 : 0);
+        ASSERT_EQ(sort->GetStats().GetPhases().size(), (size_t) 1);
+
+        delete sort;
+        delete tape;
+    }
+
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+// Sort random input with polyphase merge and check that only temp_tapes files were used
+// Write k least numbers by partial sort, check output and return count of selection passes
+int64_t CheckPartialSort(const std::vector<int32_t>& values, int64_t k, int64_t m) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    {
+        ofstream test_file(TEST_RANDOM_FILE, std::ofstream::out | std::ofstream::trunc);
+        for (size_t i = 0; i < values.size(); i++) {
+            test_file << (i > 0 ? " " : "") << values[i];
+        }
+    }
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    ISort* sort = new Sort(tape, TEST_OUTPUT_FILE, m, SortSettings());
+    sort->StartPartial(k);
+
+    std::vector<int32_t> expected = values;
+    std::sort(expected.begin(), expected.end());
+    expected.resize(std::min<size_t>(expected.size(), k));
+    CheckSortedOutput(expected);
+
+    auto& stats = ((Sort*) sort)->GetStats();
+    EXPECT_LE(((Sort*) sort)->GetPeakMemory(), m);
+    auto passes = std::count_if(stats.GetPhases().begin(), stats.GetPhases().end(),
+                                [](auto& phase) { return phase.name == "selection"; });
+    if (passes > 0) {
+        // Every pass read the whole input and nothing is written to temp tapes
+        EXPECT_EQ(stats.GetInputStats().reads, passes * (int64_t) values.size());
+        EXPECT_EQ(stats.GetTempStats().writes, 0);
+        EXPECT_EQ(stats.GetOutputStats().writes, k);
+    }
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+
+    return passes;
+}
+
+TEST(SortPartialTest, heap_test) {
+    auto values = CreateRandomInput(2000, 26);
+    ASSERT_EQ(CheckPartialSort(values, 10, 4096), 1);
+    ASSERT_EQ(CheckPartialSort(values, 0, 4096), 0);
+}
+
+TEST(SortPartialTest, passes_test) {
+    // Copies of the last number of pass are split between passes
+    std::vector<int32_t> values;
+    std::mt19937 generator(27);
+    for (int i = 0; i < 3000; i++) {
+        values.push_back(i % 3 ? (int32_t) (generator() % 5) : (int32_t) generator());
+    }
+    ASSERT_EQ(CheckPartialSort(values, 2000, 4096), 3);
+
+    // Too many passes, input is sorted and output is cut
+    auto random = CreateRandomInput(3000, 28);
+    ASSERT_EQ(CheckPartialSort(random, 2900, 1024), 0);
+    ASSERT_EQ(CheckPartialSort(random, 5000, 1024), 0);
+}
+
+// Sort numbers with counting mode, check output and return true if they were written from histogram
+bool CheckCountingSort(const std::vector<int32_t>& values, int64_t m) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    {
+        ofstream test_file(TEST_RANDOM_FILE, std::ofstream::out | std::ofstream::trunc);
+        for (size_t i = 0; i < values.size(); i++) {
+            test_file << (i > 0 ? " " : "") << values[i];
+        }
+    }
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    SortSettings sort_settings;
+    sort_settings.SetCounting(true);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, m, sort_settings);
+    sort->Start();
+
+    CheckSortedOutput(values);
+    EXPECT_LE(sort->GetPeakMemory(), m);
+
+    auto& stats = sort->GetStats();
+    EXPECT_EQ(stats.GetPhases().front().name, "counting");
+    bool counted = stats.GetPhases().size() == 1;
+    if (counted) {
+        // Input is read once, temp tapes aren't used
+        EXPECT_EQ(stats.GetInputStats().reads, (int64_t) values.size());
+        EXPECT_EQ(stats.GetTempStats().writes, 0);
+    }
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+
+    return counted;
+}
+
+TEST(SortCountingTest, counting_test) {
+    // Status codes, there are 30 distinct numbers
+    std::vector<int32_t> codes;
+    std::mt19937 generator(24);
+    for (int i = 0; i < 3000; i++) {
+        codes.push_back((int32_t) (generator() % 30) * 100 - 2000);
+    }
+    ASSERT_TRUE(CheckCountingSort(codes, 4096));
+
+    // Long run of one number is written by several blocks
+    std::vector<int32_t> equal(1000, INT32_MIN);
+    equal.push_back(INT32_MAX);
+    ASSERT_TRUE(CheckCountingSort(equal, 4096));
+}
+
+TEST(SortCountingTest, fallback_test) {
+    // Distinct numbers don't fit histogram, input is read back and sorted by merge
+    auto values = CreateRandomInput(3000, 25);
+    ASSERT_FALSE(CheckCountingSort(values, 4096));
+}
+
+// Sort numbers with distribution strategy, check output and return count of buckets of the top level
+int64_t CheckDistributionSort(const std::vector<int32_t>& values, int64_t m, SortKernel sort_kernel) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    {
+        ofstream test_file(TEST_RANDOM_FILE, std::ofstream::out | std::ofstream::trunc);
+        for (size_t i = 0; i < values.size(); i++) {
+            test_file << (i > 0 ? " " : "") << values[i];
+        }
+    }
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    SortSettings sort_settings;
+    sort_settings.SetStrategy(SortStrategy::Distribution);
+    sort_settings.SetSortKernel(sort_kernel);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, m, sort_settings);
+    sort->Start();
+
+    CheckSortedOutput(values);
+    EXPECT_LE(sort->GetPeakMemory(), m);
+
+    auto& phases = sort->GetStats().GetPhases();
+    EXPECT_EQ(phases.size(), 3u);
+    EXPECT_EQ(phases[0].name, "sampling");
+    EXPECT_EQ(phases[1].name, "distribution");
+    EXPECT_EQ(phases[2].name, "bucket_sort");
+    int64_t buckets = phases[1].runs;
+
+    // Input is read by sampling and distribution passes, output is written once
+    EXPECT_EQ(sort->GetStats().GetInputStats().reads, 2 * (int64_t) values.size());
+    EXPECT_EQ(sort->GetStats().GetOutputStats().writes, (int64_t) values.size());
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+
+    // Bucket tapes are removed after they are sorted
+    EXPECT_TRUE(std::filesystem::is_empty(std::string(TMP_FOLDER) + "/0"));
+
+    return buckets;
+}
+
+TEST(SortDistributionTest, random_test) {
+    auto values = CreateRandomInput(600, 21);
+    ASSERT_GT(CheckDistributionSort(values, 1024, SortKernel::Std), 1);
+    CheckDistributionSort(values, 2600, SortKernel::Radix);
+}
+
+TEST(SortDistributionTest, duplicates_test) {
+    // Numbers equal to splitters are counted and don't go to buckets
+    std::vector<int32_t> values;
+    std::mt19937 generator(22);
+    for (int i = 0; i < 500; i++) {
+        values.push_back((int32_t) (generator() % 3) - 1);
+    }
+    CheckDistributionSort(values, 1024, SortKernel::Std);
+
+    std::vector<int32_t> equal(400, 7);
+    equal.push_back(-5);
+    equal.push_back(INT32_MAX);
+    CheckDistributionSort(equal, 1024, SortKernel::Std);
+}
+
+TEST(SortDistributionTest, recursive_test) {
+    // Buckets are bigger than run buffer when fan-in is small, they are distributed again
+    auto values = CreateRandomInput(2000, 23);
+    CheckDistributionSort(values, 512, SortKernel::Std);
+
+    std::vector<int32_t> sorted(1000);
+    for (int i = 0; i < 1000; i++) {
+        sorted[i] = i * 3;
+    }
+    CheckDistributionSort(sorted, 512, SortKernel::Std);
+}
+
+void CheckPolyphaseSort(int64_t n, int64_t m, int32_t temp_tapes, RunGeneration run_generation,
+                        int32_t sort_threads = 0, MergeMode merge_mode = MergeMode::Polyphase) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    auto values = CreateRandomInput(n, (uint32_t) (n + temp_tapes));
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    SortSettings sort_settings;
+    sort_settings.SetRunGeneration(run_generation);
+    sort_settings.SetMergeMode(merge_mode);
+    sort_settings.SetTempTapes(temp_tapes);
+    sort_settings.SetSortThreads(sort_threads);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, m, sort_settings);
+    sort->Start();
+
+    CheckSortedOutput(values);
+    ASSERT_LE(sort->GetPeakMemory(), m);
+
+    // Input of one run is sorted without temp tapes
+    if (n > sort->GetMemoryPlan().GetRunBuffer()) {
+        int64_t files = std::distance(std::filesystem::directory_iterator(std::string(TMP_FOLDER) + "/0"),
+                                      std::filesystem::directory_iterator());
+        ASSERT_EQ(files, temp_tapes);
+    } else {
+        ASSERT_FALSE(std::filesystem::exists(std::string(TMP_FOLDER) + "/0"));
+    }
+    ASSERT_FALSE(std::filesystem::exists(std::string(TMP_FOLDER) + "/1"));
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+// Check phases and counters of sort of 200 numbers
+void CheckSortStats(MergeMode merge_mode, const std::string& merge_phase) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    auto values = CreateRandomInput(200, 17);
+
+    TapeSettings settings;
+    auto tape = new Tape(TEST_RANDOM_FILE, settings);
+
+    SortSettings sort_settings;
+    sort_settings.SetMergeMode(merge_mode);
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 256, sort_settings);
+    sort->Start();
+    CheckSortedOutput(values);
+
+    auto& stats = sort->GetStats();
+    ASSERT_EQ(stats.GetN(), 200);
+    ASSERT_GT(stats.GetRuns(), 1);
+    ASSERT_GT(stats.GetMergePasses(), 0);
+
+    auto& phases = stats.GetPhases();
+    ASSERT_EQ(phases.front().name, "run_generation");
+    ASSERT_EQ(phases.front().runs, stats.GetRuns());
+    // The last merge write straight to output tape
+    ASSERT_EQ(phases.back().name, merge_phase);
+    ASSERT_EQ(std::count_if(phases.begin(), phases.end(), [&](auto& phase) { return phase.name == merge_phase; }),
+              stats.GetMergePasses());
+
+    // Input is read once, output is written once, every merge pass read part of numbers from temp tapes
+    ASSERT_EQ(stats.GetInputStats().reads, 200);
+    ASSERT_EQ(stats.GetOutputStats().writes, 200);
+    ASSERT_GE(stats.GetTempStats().writes, 200);
+    ASSERT_GE(stats.GetDataPasses(), 1);
+
+    auto json = stats.ToJson();
+    ASSERT_NE(json.find("\"merge_passes\": " + std::to_string(stats.GetMergePasses())), std::string::npos);
+    ASSERT_NE(json.find("\"name\": \"" + merge_phase + "\""), std::string::npos);
+    ASSERT_NE(json.find("\"output\": {\"reads\": "), std::string::npos);
+
+    delete sort;
+    delete tape;
+    std::filesystem::remove(TEST_RANDOM_FILE);
+    RefreshTestOutput();
+}
+
+TEST(SortStatsTest, balanced_test) {
+    CheckSortStats(MergeMode::Balanced, "merge_round");
+}
+
+TEST(SortStatsTest, polyphase_test) {
+    CheckSortStats(MergeMode::Polyphase, "merge_phase");
+}
+
+TEST(SortPolyphaseTest, three_tapes_test) {
+    CheckPolyphaseSort(200, 160, 3, RunGeneration::Chunk);
+}
+
+TEST(SortPolyphaseTest, five_tapes_test) {
+    CheckPolyphaseSort(200, 256, 5, RunGeneration::ReplacementSelection);
+}
+
+TEST(SortPolyphaseTest, pipeline_test) {
+    CheckPolyphaseSort(200, 512, 4, RunGeneration::Chunk, 3);
+}
+
+TEST(SortPolyphaseTest, natural_test) {
+    CheckPolyphaseSort(200, 256, 4, RunGeneration::Natural);
+}
+
+TEST(SortPolyphaseTest, one_run_test) {
+    CheckPolyphaseSort(5, 4096, 4, RunGeneration::Chunk);
+}
+
+TEST(SortPolyphaseTest, backward_test) {
+    // Replacement selection is replaced with chunks
+    CheckPolyphaseSort(200, 160, 3, RunGeneration::ReplacementSelection, 0, MergeMode::Backward);
+    CheckPolyphaseSort(300, 256, 5, RunGeneration::Chunk, 2, MergeMode::Backward);
+    CheckPolyphaseSort(5, 4096, 4, RunGeneration::Chunk, 0, MergeMode::Backward);
+}
+
+// Distribute runs of random length to polyphase merge and check merged result
+// Tapes wait only rewinds, so their time show how many rewinds were done
+void CheckPolyphaseMerge(int64_t runs, int32_t temp_tapes, int64_t buffer_size, bool backward) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    TapeSettings settings(0, 0, 1, 0);
+    settings.SetClockMode(ClockMode::Virtual);
+
+    std::vector<ITape*> tapes;
+    for (int32_t i = 0; i < temp_tapes; i++) {
+        tapes.push_back(new BinaryTape(std::string(TMP_FOLDER) + "/" + std::to_string(i) + ".bin", settings));
+    }
+    auto polyphase = new PolyphaseMerge(tapes, nullptr, buffer_size, backward);
+    polyphase->Expect(runs);
+
+    std::mt19937 random((uint32_t) runs);
+    std::vector<int32_t> expected;
+    for (int64_t i = 0; i < runs; i++) {
+        std::vector<int32_t> run(1 + random() % 7);
+        for (auto& n: run) {
+            n = (int32_t) (random() % 100) - 50;
+        }
+        std::sort(run.begin(), run.end());
+        expected.insert(expected.end(), run.begin(), run.end());
+        auto tape = polyphase->BeginRun();
+        if (polyphase->IsRunDescending()) {
+            std::reverse(run.begin(), run.end());
+        }
+        tape->WriteBlock(run.data(), (int64_t) run.size());
+        polyphase->EndRun((int64_t) run.size());
+    }
+    std::sort(expected.begin(), expected.end());
+
+    // The last merge write to output tape
+    auto out = new BinaryTape(std::string(TMP_FOLDER) + "/out.bin", settings);
+    ASSERT_EQ(polyphase->Merge(out), out);
+    out->Rewind();
+    std::vector<int32_t> merged(out->GetN());
+    ASSERT_EQ(out->ReadBlock(merged.data(), (int64_t) merged.size()), out->GetN());
+    ASSERT_EQ(merged, expected);
+    delete out;
+
+    std::chrono::microseconds rewinds(0);
+    for (auto tape: tapes) {
+        rewinds += tape->GetDeviceTime();
+    }
+    if (backward) {
+        ASSERT_EQ(rewinds.count(), 0);
+    } else {
+        ASSERT_GT(rewinds.count(), 0);
+    }
+
+    delete polyphase;
+    DeleteDirectoryContents(TMP_FOLDER);
+}
+
+TEST(PolyphaseMergeTest, backward_test) {
+    for (int64_t runs = 0; runs < 40; runs++) {
+        CheckPolyphaseMerge(runs, 3, 0, true);
+        CheckPolyphaseMerge(runs, 4, 3, true);
+        CheckPolyphaseMerge(runs, 6, 2, true);
+    }
+    CheckPolyphaseMerge(40, 4, 3, false);
+}
+
+TEST(MemoryPlanTest, balanced_test) {
+    SortSettings settings;
+    settings.SetRunGeneration(RunGeneration::Chunk);
+
+    // Half of 4096 bytes is split between 3 tape blocks
+    MemoryPlan plan(4096, settings);
+    ASSERT_EQ(plan.GetBlockSize(), 170);
+    ASSERT_EQ(plan.GetRunBuffer(), (4096 - 170 * CELL_SIZE) / 4);
+    ASSERT_EQ(plan.GetFanIn(), (4096 - 170 * CELL_SIZE) / (170 * CELL_SIZE + LOSER_TREE_WAY_BYTES));
+    ASSERT_TRUE(plan.Fits());
+    ASSERT_LE(plan.GetRunGenerationBytes(), 4096);
+    ASSERT_LE(plan.GetMergeBytes(), 4096);
+
+    // Merge of 2 tapes can't fit
+    MemoryPlan small_plan(64, settings);
+    ASSERT_FALSE(small_plan.Fits());
+}
+
+TEST(MemoryPlanTest, polyphase_test) {
+    SortSettings settings;
+    settings.SetRunGeneration(RunGeneration::ReplacementSelection);
+    settings.SetMergeMode(MergeMode::Polyphase);
+    settings.SetTempTapes(5);
+
+    MemoryPlan plan(4800, settings);
+    ASSERT_EQ(plan.GetBlockSize(), 100);
+    ASSERT_EQ(plan.GetFanIn(), 4);
+    // Replacement selection keep 8 bytes for every number
+    ASSERT_EQ(plan.GetRunBuffer(), (4800 - 5 * 100 * CELL_SIZE) / 8);
+    ASSERT_TRUE(plan.Fits());
+}
+
+TEST(MemoryPlanTest, pipeline_test) {
+    SortSettings settings;
+    settings.SetRunGeneration(RunGeneration::Chunk);
+    settings.SetSortThreads(2);
+
+    // Run generation memory is split between reader, 2 sort threads and writer
+    MemoryPlan plan(4096, settings);
+    ASSERT_EQ(plan.GetRunBuffers(), 4);
+    ASSERT_EQ(plan.GetRunBuffer(), (4096 - 170 * CELL_SIZE) / (4 * 4));
+    ASSERT_TRUE(plan.Fits());
+
+    // Replacement selection have one heap
+    settings.SetRunGeneration(RunGeneration::ReplacementSelection);
+    ASSERT_EQ(MemoryPlan(4096, settings).GetRunBuffers(), 1);
+}
+
+TEST(MemoryPlanTest, radix_sort_test) {
+    SortSettings settings;
+    settings.SetRunGeneration(RunGeneration::Chunk);
+    settings.SetSortKernel(SortKernel::Radix);
+
+    // Chunk and scratch buffer share memory of run generation
+    MemoryPlan plan(4096, settings);
+    ASSERT_TRUE(plan.GetRadixSort());
+    ASSERT_EQ(plan.GetScratchBuffers(), 1);
+    ASSERT_EQ(plan.GetRunBuffer(), (4096 - 170 * CELL_SIZE) / (2 * 4));
+    ASSERT_TRUE(plan.Fits());
+
+    // Every sort thread of pipeline has own scratch buffer
+    settings.SetSortThreads(2);
+    ASSERT_EQ(MemoryPlan(1 << 16, settings).GetScratchBuffers(), 2);
+
+    // Chunks would be too short for radix sort, so std::sort is used
+    settings.SetSortThreads(0);
+    MemoryPlan small_plan(1024, settings);
+    ASSERT_FALSE(small_plan.GetRadixSort());
+    ASSERT_EQ(small_plan.GetRunBuffer(), (1024 - 42 * CELL_SIZE) / 4);
+}
+
+TEST(MemoryPlanTest, natural_test) {
+    SortSettings settings;
+    settings.SetRunGeneration(RunGeneration::Natural);
+    settings.SetSortKernel(SortKernel::Radix);
+
+    // Natural runs are merged through one scratch buffer, sort kernel isn't used
+    MemoryPlan plan(4096, settings);
+    ASSERT_FALSE(plan.GetRadixSort());
+    ASSERT_EQ(plan.GetScratchBuffers(), 1);
+    ASSERT_EQ(plan.GetRunBuffer(), (4096 - 170 * CELL_SIZE) / (2 * 4));
+    ASSERT_TRUE(plan.Fits());
+}
+
+TEST(MemoryPlanTest, drives_test) {
+    SortSettings settings;
+    settings.SetDrives(4);
+
+    // Every drive merge own group of tapes
+    MemoryPlan plan(1 << 16, settings);
+    ASSERT_EQ(plan.GetBlockSize(), (1 << 16) / 2 / (12 * CELL_SIZE));
+    ASSERT_EQ(plan.GetMergeThreads(), 4);
+    ASSERT_TRUE(plan.Fits());
+
+    // Memory is enough only for 2 merges
+    MemoryPlan small_plan(200, settings);
+    ASSERT_EQ(small_plan.GetMergeThreads(), 2);
+    ASSERT_EQ(small_plan.GetFanIn(), 2);
+    ASSERT_TRUE(small_plan.Fits());
+
+    // Polyphase merge has one merge in every phase
+    settings.SetMergeMode(MergeMode::Polyphase);
+    ASSERT_EQ(MemoryPlan(1 << 16, settings).GetMergeThreads(), 1);
+}
+
+TEST(MemoryPlanTest, prefetch_test) {
+    SortSettings settings;
+    settings.SetPrefetch(true);
+
+    // Every tape has block and prefetch buffer
+    MemoryPlan plan(4096, settings);
+    ASSERT_EQ(plan.GetBlockSize(), 4096 / 2 / (3 * (CELL_SIZE + PREFETCH_CELL_BYTES)));
+    ASSERT_EQ(plan.GetTapeBytes(), plan.GetBlockSize() * (CELL_SIZE + PREFETCH_CELL_BYTES));
+    ASSERT_TRUE(plan.Fits());
+}
+
+TEST(MemoryPlanTest, merge_buffer_test) {
+    SortSettings settings;
+
+    // Memory that left after fan-in is taken is given to merge buffers
+    MemoryPlan plan(4096, settings);
+    ASSERT_GT(plan.GetMergeBuffer(), 0);
+    ASSERT_LE(plan.GetMergeBuffer(), plan.GetBlockSize());
+    ASSERT_LE(plan.GetMergeBytes(), 4096);
+
+    // Nothing is left, merge read numbers one by one
+    MemoryPlan small_plan(124, settings);
+    ASSERT_EQ(small_plan.GetMergeBuffer(), 0);
+    ASSERT_TRUE(small_plan.Fits());
+}
+
+TEST(MemoryPlanTest, distribution_test) {
+    SortSettings settings;
+    ASSERT_EQ(MemoryPlan(4096, settings).GetBuckets(), 0);
+
+    // Buckets are written with merge buffers, output and scattered tapes stay opened
+    settings.SetStrategy(SortStrategy::Distribution);
+    MemoryPlan plan(4096, settings);
+    ASSERT_GE(plan.GetBuckets(), plan.GetFanIn() - 1);
+    ASSERT_LE(plan.GetDistributionBytes(), 4096);
+    ASSERT_GT(plan.GetDistributionBytes() + plan.GetTapeBytes() + plan.GetMergeBuffer() * CELL_SIZE, 4096);
+    ASSERT_TRUE(plan.Fits());
+
+    // Small blocks leave memory for buckets even if merge read numbers one by one
+    MemoryPlan small_plan(124, settings);
+    ASSERT_EQ(small_plan.GetMergeBuffer(), 0);
+    ASSERT_GE(small_plan.GetBuckets(), 2);
+    ASSERT_LE(small_plan.GetDistributionBytes(), 124);
+}
+
+TEST(MemoryPlanTest, counting_test) {
+    SortSettings settings;
+    ASSERT_EQ(MemoryPlan(4096, settings).GetHistogramSlots(), 0);
+
+    // Histogram take power of 2 slots, memory of grow fit limit with output tape and buffer
+    settings.SetCounting(true);
+    MemoryPlan plan(4096, settings);
+    ASSERT_GT(plan.GetHistogramSlots(), 0);
+    ASSERT_EQ(plan.GetHistogramSlots() & (plan.GetHistogramSlots() - 1), 0);
+    ASSERT_LE(plan.GetCountingBytes(), 4096);
+    ASSERT_GT(plan.GetCountingBytes() + plan.GetHistogramSlots() * 3 / 2 * HISTOGRAM_SLOT_BYTES, 4096);
+    ASSERT_TRUE(plan.Fits());
+}
+
+TEST(MemoryPlanTest, too_small_sort_test) {
+    DeleteDirectoryContents(TMP_FOLDER);
+    TapeSettings settings;
+    auto tape = new Tape(TEST_INPUT_FILE, settings);
+
+    auto sort = new Sort(tape, TEST_OUTPUT_FILE, 64);
+    ASSERT_THROW(sort->Start(), std::invalid_argument);
+
+    delete sort;
+    delete tape;
+}
+
+TEST(MemoryAccountTest, budget_vector_test) {
+    MemoryAccount account(1024);
+    {
+        BudgetVector<int32_t> first(100, 0, BudgetAllocator<int32_t>(&account));
+        ASSERT_EQ(account.GetCurrent(), 400);
+        BudgetVector<int64_t> second(50, 0, BudgetAllocator<int64_t>(&account));
+        ASSERT_EQ(account.GetCurrent(), 800);
+    }
+    ASSERT_EQ(account.GetCurrent(), 0);
+    ASSERT_EQ(account.GetPeak(), 800);
+
+    // Vector without account isn't counted
+    BudgetVector<int32_t> free(1000);
+    ASSERT_EQ(account.GetCurrent(), 0);
 }
 
 int main(int argc, char **argv) {